@@ -0,0 +1,60 @@
+// malloc interposer for the benchmarks: counts calls and tracks live and
+// peak heap bytes. Only glibc lets a program replace malloc by defining it;
+// elsewhere the counters stay at zero and bench_alloc_hooked is 0.
+
+#include <stdlib.h>
+#include <stddef.h>
+
+size_t bench_allocs;
+size_t bench_live;
+size_t bench_peak;
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+int bench_alloc_hooked = 1;
+
+extern void *__libc_malloc(size_t n);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *p, size_t n);
+extern void __libc_free(void *p);
+
+static void bench_track(void *p) {
+    size_t n = malloc_usable_size(p);
+    __atomic_fetch_add(&bench_allocs, 1, __ATOMIC_RELAXED);
+    size_t live = __atomic_add_fetch(&bench_live, n, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&bench_peak, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&bench_peak, &peak, live, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+static void bench_untrack(void *p) {
+    if (p) __atomic_fetch_sub(&bench_live, malloc_usable_size(p), __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t n) {
+    void *p = __libc_malloc(n);
+    if (p) bench_track(p);
+    return p;
+}
+
+void *calloc(size_t n, size_t size) {
+    void *p = __libc_calloc(n, size);
+    if (p) bench_track(p);
+    return p;
+}
+
+void *realloc(void *old, size_t n) {
+    bench_untrack(old);
+    void *p = __libc_realloc(old, n);
+    if (p) bench_track(p);
+    else if (old && n) __atomic_fetch_add(&bench_live, malloc_usable_size(old), __ATOMIC_RELAXED);
+    return p;
+}
+
+void free(void *p) {
+    bench_untrack(p);
+    __libc_free(p);
+}
+#else
+int bench_alloc_hooked = 0;
+#endif
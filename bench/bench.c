@@ -0,0 +1,1124 @@
+// clargs benchmark suite: prints one JSON object per line so runs from
+// different commits can be compared with compare.awk. Link with alloc.c
+// for allocation counts and peak heap bytes.
+//
+//   ./bench [filter]      only run benchmarks whose name contains filter
+//   BENCH_MS=50 ./bench   time budget per repetition (default 10 ms)
+
+#define _GNU_SOURCE
+#include "clargs.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <unistd.h>
+
+extern size_t bench_allocs, bench_live, bench_peak;
+extern int bench_alloc_hooked;
+
+static double bench_ms = 10;
+static const char *bench_filter;
+
+static double now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static int wanted(const char *name) {
+    return !bench_filter || strstr(name, bench_filter);
+}
+
+// timing
+
+typedef void (*BenchFn)(void *ctx, long iters);
+
+typedef struct {
+    double ns;              // per iteration, best of the repetitions
+    double allocs;          // mallocs per iteration
+} BenchStat;
+
+// doubles the iteration count until one run takes bench_ms, then keeps the
+// fastest of five runs of that length
+static BenchStat bench_time(BenchFn fn, void *ctx) {
+    BenchStat st;
+    long iters = 1;
+    for (;;) {
+        double t = now_ns();
+        fn(ctx, iters);
+        if (now_ns() - t >= bench_ms * 1e6 || iters >= (1L << 30)) break;
+        iters *= 2;
+    }
+    st.ns = 1e300;
+    for (int rep=0;rep<5;rep++) {
+        size_t a = bench_allocs;
+        double t = now_ns();
+        fn(ctx, iters);
+        double ns = (now_ns() - t) / iters;
+        if (ns < st.ns) st.ns = ns;
+        if (rep == 0) st.allocs = (double)(bench_allocs - a) / iters;
+    }
+    return st;
+}
+
+// one JSON object per result; negative values are left out
+static void emit(const char *name, double ns, double units, double allocs, double peak) {
+    printf("{\"name\":\"%s\",\"ns_per_op\":%.1f", name, ns);
+    if (units > 0) printf(",\"ns_per_unit\":%.3f,\"units\":%.0f", ns / units, units);
+    if (allocs >= 0 && bench_alloc_hooked) printf(",\"allocs_per_op\":%.2f", allocs);
+    if (peak >= 0 && bench_alloc_hooked) printf(",\"peak_bytes\":%.0f", peak);
+    printf("}\n");
+    fflush(stdout);
+}
+
+static void name_of(char *buf, size_t size, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+}
+
+// fixtures
+
+static unsigned long long rng = 0x9E3779B97F4A7C15ull;
+
+static unsigned rnd(unsigned n) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    return (unsigned)(rng % n);
+}
+
+static const char *const mode_name[] = { "heap", "arena", "borrow" };
+static const int mode_flags[] = { 0, CL_ARENA, CL_BORROW };
+
+// n options cycling through int, string, flag and double, named optN
+static Clargs *make_spec(int n, int flags, char **names) {
+    Clargs *p = cl_create_ex("bench", "benchmark spec", flags);
+    for (int i=0;i<n;i++) {
+        char *name = names[i];
+        switch (i % 4) {
+            case 0: cl_add_int(p, 0, name, NULL, "an int", 0, 1); break;
+            case 1: cl_add_string(p, 0, name, NULL, "a string", 0, "default"); break;
+            case 2: cl_add_flag(p, 0, name, "a flag"); break;
+            default: cl_add_double(p, 0, name, NULL, "a double", 0, 0.5); break;
+        }
+    }
+    cl_freeze(p);
+    return p;
+}
+
+static char **make_names(int n) {
+    char **names = (char**)malloc(n * sizeof(char*));
+    for (int i=0;i<n;i++) {
+        names[i] = (char*)malloc(16);
+        snprintf(names[i], 16, "opt%d", i);
+    }
+    return names;
+}
+
+static void free_names(char **names, int n) {
+    for (int i=0;i<n;i++) free(names[i]);
+    free(names);
+}
+
+// an argv of about argc tokens naming random options of a make_spec spec
+static char **make_argv(int nopts, int argc, int *out_argc) {
+    char **argv = (char**)malloc((argc + 2) * sizeof(char*));
+    int k = 0;
+    argv[k++] = (char*)"bench";
+    while (k < argc) {
+        int i = (int)rnd((unsigned)nopts);
+        char *tok = (char*)malloc(24);
+        snprintf(tok, 24, "--opt%d", i);
+        argv[k++] = tok;
+        if (i % 4 == 2) continue;
+        char *val = (char*)malloc(24);
+        switch (i % 4) {
+            case 0: snprintf(val, 24, "%u", rnd(1000000)); break;
+            case 1: snprintf(val, 24, "value%u", rnd(1000)); break;
+            default: snprintf(val, 24, "%u.%u", rnd(1000), rnd(100)); break;
+        }
+        argv[k++] = val;
+    }
+    argv[k] = NULL;
+    *out_argc = k;
+    return argv;
+}
+
+static void free_argv(char **argv, int argc) {
+    for (int i=1;i<argc;i++) free(argv[i]);
+    free(argv);
+}
+
+// parse throughput
+
+typedef struct {
+    Clargs *p;
+    ClResult *r;
+    int argc;
+    char **argv;
+} ParseCtx;
+
+static void run_parse(void *ctx, long iters) {
+    ParseCtx *c = (ParseCtx*)ctx;
+    for (long i=0;i<iters;i++) cl_parse(c->p, c->argc, c->argv);
+}
+
+static void run_parse_r(void *ctx, long iters) {
+    ParseCtx *c = (ParseCtx*)ctx;
+    for (long i=0;i<iters;i++) cl_parse_r(c->p, c->r, c->argc, c->argv);
+}
+
+static void bench_parse(void) {
+    static const int opts[] = { 10, 100, 1000, 10000 };
+    static const int lens[] = { 8, 64, 512 };
+    char name[128];
+    for (int o=0;o<4;o++) {
+        char **names = make_names(opts[o]);
+        for (int m=0;m<3;m++) {
+            Clargs *p = make_spec(opts[o], mode_flags[m], names);
+            ClResult *r = cl_result_new(p);
+            for (int l=0;l<3;l++) {
+                ParseCtx c = { p, r, 0, NULL };
+                c.argv = make_argv(opts[o], lens[l], &c.argc);
+                name_of(name, sizeof name, "parse/%s/opts=%d/argc=%d", mode_name[m], opts[o], lens[l]);
+                if (wanted(name)) {
+                    BenchStat st = bench_time(run_parse, &c);
+                    emit(name, st.ns, c.argc - 1, st.allocs, -1);
+                }
+                name_of(name, sizeof name, "parse_r/%s/opts=%d/argc=%d", mode_name[m], opts[o], lens[l]);
+                if (wanted(name)) {
+                    BenchStat st = bench_time(run_parse_r, &c);
+                    emit(name, st.ns, c.argc - 1, st.allocs, -1);
+                }
+                free_argv(c.argv, c.argc);
+            }
+            cl_result_free(r);
+            cl_free(p);
+        }
+        free_names(names, opts[o]);
+    }
+}
+
+// cl_parse_r on one frozen spec from 1..nproc threads, each with its own
+// result; ns_per_unit is wall time per parse across all threads
+
+typedef struct {
+    Clargs *p;
+    ClResult **rs;
+    int n;
+    int *argcs;
+    char ***argvs;
+    int threads;
+    long iters;
+} ThreadCtx;
+
+typedef struct {
+    ThreadCtx *c;
+    int t;
+} ThreadJob;
+
+static void *thread_worker(void *arg) {
+    ThreadJob *j = (ThreadJob*)arg;
+    ThreadCtx *c = j->c;
+    ClResult *r = c->rs[j->t];
+    for (long i=0, k=j->t * 37 % c->n;i<c->iters;i++, k = k + 1 < c->n ? k + 1 : 0) cl_parse_r(c->p, r, c->argcs[k], c->argvs[k]);
+    return NULL;
+}
+
+static void run_threads(void *ctx, long iters) {
+    ThreadCtx *c = (ThreadCtx*)ctx;
+    pthread_t tids[256];
+    ThreadJob jobs[256];
+    c->iters = iters;
+    for (int t=0;t<c->threads;t++) {
+        jobs[t].c = c;
+        jobs[t].t = t;
+        if (t && pthread_create(&tids[t], NULL, thread_worker, &jobs[t]) != 0) tids[t] = 0, thread_worker(&jobs[t]);
+    }
+    thread_worker(&jobs[0]);
+    for (int t=1;t<c->threads;t++) if (tids[t]) pthread_join(tids[t], NULL);
+}
+
+static void bench_threads(void) {
+    enum { OPTS = 100, LINES = 1024, ARGC = 64 };
+    char name[128];
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu < 1) ncpu = 1;
+    if (ncpu > 256) ncpu = 256;
+    char **names = make_names(OPTS);
+    ThreadCtx c;
+    memset(&c, 0, sizeof c);
+    c.p = make_spec(OPTS, 0, names);
+    c.n = LINES;
+    c.rs = (ClResult**)malloc(ncpu * sizeof(ClResult*));
+    for (long t=0;t<ncpu;t++) c.rs[t] = cl_result_new(c.p);
+    c.argcs = (int*)malloc(LINES * sizeof(int));
+    c.argvs = (char***)malloc(LINES * sizeof(char**));
+    for (int i=0;i<LINES;i++) c.argvs[i] = make_argv(OPTS, ARGC, &c.argcs[i]);
+    // powers of two, then the core count itself
+    for (long t=1;;t*=2) {
+        c.threads = (int)(t < ncpu ? t : ncpu);
+        name_of(name, sizeof name, "parse_r/threads=%d/opts=%d/argc=%d", c.threads, OPTS, ARGC);
+        if (wanted(name)) {
+            BenchStat st = bench_time(run_threads, &c);
+            emit(name, st.ns, c.threads, -1, -1);
+        }
+        if (c.threads == ncpu) break;
+    }
+    for (int i=0;i<LINES;i++) free_argv(c.argvs[i], c.argcs[i]);
+    free(c.argcs);
+    free(c.argvs);
+    for (long t=0;t<ncpu;t++) cl_result_free(c.rs[t]);
+    free(c.rs);
+    cl_free(c.p);
+    free_names(names, OPTS);
+}
+
+// getter latency
+
+typedef struct {
+    Clargs *p;
+    char **names;
+    int n;                  // options of the kind being read: every 4th from first
+    int first;
+    volatile long sink;
+} GetCtx;
+
+static void run_get_name(void *ctx, long iters) {
+    GetCtx *c = (GetCtx*)ctx;
+    long s = 0;
+    for (long i=0, k=0;i<iters;i++, k = k + 1 < c->n ? k + 1 : 0) s += cl_get_int(c->p, c->names[4 * k + c->first], NULL);
+    c->sink = s;
+}
+
+static void run_get_string(void *ctx, long iters) {
+    GetCtx *c = (GetCtx*)ctx;
+    long s = 0;
+    for (long i=0, k=0;i<iters;i++, k = k + 1 < c->n ? k + 1 : 0) s += cl_get_string(c->p, c->names[4 * k + c->first])[0];
+    c->sink = s;
+}
+
+static void run_get_at(void *ctx, long iters) {
+    GetCtx *c = (GetCtx*)ctx;
+    long s = 0;
+    for (long i=0, k=0;i<iters;i++, k = k + 1 < c->n ? k + 1 : 0) s += cl_get_int_at(c->p, (int)(4 * k + c->first), NULL);
+    c->sink = s;
+}
+
+static void run_rget(void *ctx, long iters) {
+    GetCtx *c = (GetCtx*)ctx;
+    const ClResult *r = &c->p->res;
+    long s = 0;
+    for (long i=0, k=0;i<iters;i++, k = k + 1 < c->n ? k + 1 : 0) s += cl_rget_int(r, (int)(4 * k + c->first), NULL);
+    c->sink = s;
+}
+
+static void bench_getters(void) {
+    static const int opts[] = { 10, 100, 1000, 10000 };
+    static const struct { const char *name; BenchFn fn; int first; } getters[] = {
+        { "get_int_by_name", run_get_name, 0 },
+        { "get_string_by_name", run_get_string, 1 },
+        { "get_int_at", run_get_at, 0 },
+        { "rget_int", run_rget, 0 },
+    };
+    char name[128];
+    for (int o=0;o<4;o++) {
+        char **names = make_names(opts[o]);
+        Clargs *p = make_spec(opts[o], 0, names);
+        GetCtx c;
+        c.p = p; c.names = names; c.sink = 0;
+        for (int g=0;g<4;g++) {
+            name_of(name, sizeof name, "getter/%s/opts=%d", getters[g].name, opts[o]);
+            if (!wanted(name)) continue;
+            c.first = getters[g].first;
+            c.n = (opts[o] - c.first + 3) / 4;
+            BenchStat st = bench_time(getters[g].fn, &c);
+            emit(name, st.ns, -1, st.allocs, -1);
+        }
+        cl_free(p);
+        free_names(names, opts[o]);
+    }
+}
+
+// memory: cost of building a spec and of one parse into it
+
+static void bench_memory(void) {
+    static const int opts[] = { 10, 100, 1000, 10000 };
+    char name[128];
+    for (int o=0;o<4;o++) {
+        for (int m=0;m<3;m++) {
+            name_of(name, sizeof name, "memory/%s/opts=%d", mode_name[m], opts[o]);
+            if (!wanted(name)) continue;
+            char **names = make_names(opts[o]);
+            int argc;
+            char **argv = make_argv(opts[o], 512, &argc);
+            size_t live = bench_live, a = bench_allocs;
+            bench_peak = live;
+            double t = now_ns();
+            Clargs *p = make_spec(opts[o], mode_flags[m], names);
+            cl_parse(p, argc, argv);
+            double ns = now_ns() - t;
+            printf("{\"name\":\"%s\",\"ns_per_op\":%.1f,\"footprint_bytes\":%zu", name, ns, cl_footprint(p));
+            if (bench_alloc_hooked) printf(",\"allocs_per_op\":%zu,\"peak_bytes\":%zu", bench_allocs - a, bench_peak - live);
+            printf("}\n");
+            cl_free(p);
+            free_argv(argv, argc);
+            free_names(names, opts[o]);
+        }
+    }
+}
+
+// batch parsing
+
+typedef struct {
+    Clargs *p;
+    ClResult *r;
+    char *text;
+    char *work;
+    size_t len;
+    ClTable *t;
+    int n;
+    int *argcs;
+    char ***argvs;
+    char **names;
+    int threads;
+} BatchCtx;
+
+// the loop batch parsing replaces: a fresh parser per line
+static void run_baseline(void *ctx, long iters) {
+    BatchCtx *c = (BatchCtx*)ctx;
+    for (long i=0;i<iters;i++)
+        for (int k=0;k<c->n;k++) {
+            Clargs *p = make_spec(16, 0, c->names);
+            cl_parse(p, c->argcs[k], c->argvs[k]);
+            cl_free(p);
+        }
+}
+
+static void run_lines(void *ctx, long iters) {
+    BatchCtx *c = (BatchCtx*)ctx;
+    for (long i=0;i<iters;i++) {
+        memcpy(c->work, c->text, c->len);
+        cl_parse_lines(c->p, c->r, c->work, c->len, NULL, NULL);
+    }
+}
+
+static void run_table(void *ctx, long iters) {
+    BatchCtx *c = (BatchCtx*)ctx;
+    for (long i=0;i<iters;i++) cl_parse_table_mt(c->t, c->n, c->argcs, c->argvs, c->threads);
+}
+
+static void bench_batch(void) {
+    enum { LINES = 100000 };
+    char name[128];
+    char **names = make_names(16);
+    BatchCtx c;
+    memset(&c, 0, sizeof c);
+    c.p = make_spec(16, 0, names);
+    c.r = cl_result_new(c.p);
+    c.n = LINES;
+    c.argcs = (int*)malloc(LINES * sizeof(int));
+    c.argvs = (char***)malloc(LINES * sizeof(char**));
+    size_t cap = 1 << 20;
+    c.text = (char*)malloc(cap);
+    for (int i=0;i<LINES;i++) {
+        c.argvs[i] = make_argv(16, 9, &c.argcs[i]);
+        for (int k=0;k<c.argcs[i];k++) {
+            size_t n = strlen(c.argvs[i][k]);
+            if (c.len + n + 2 > cap) c.text = (char*)realloc(c.text, cap *= 2);
+            memcpy(c.text + c.len, c.argvs[i][k], n);
+            c.len += n;
+            c.text[c.len++] = k + 1 < c.argcs[i] ? ' ' : '\n';
+        }
+    }
+    c.work = (char*)malloc(c.len);
+    c.names = names;
+    name_of(name, sizeof name, "batch/baseline/n=%d", LINES);
+    if (wanted(name)) {
+        BenchStat st = bench_time(run_baseline, &c);
+        emit(name, st.ns, LINES, st.allocs, -1);
+    }
+    name_of(name, sizeof name, "batch/lines/n=%d", LINES);
+    if (wanted(name)) {
+        BenchStat st = bench_time(run_lines, &c);
+        emit(name, st.ns, LINES, st.allocs, -1);
+    }
+    c.t = cl_table_create(c.p, LINES);
+    for (c.threads = 1; c.threads <= 4; c.threads *= 2) {
+        name_of(name, sizeof name, "batch/table/n=%d/threads=%d", LINES, c.threads);
+        if (!wanted(name)) continue;
+        BenchStat st = bench_time(run_table, &c);
+        emit(name, st.ns, LINES, st.allocs, -1);
+    }
+    cl_table_free(c.t);
+    for (int i=0;i<LINES;i++) free_argv(c.argvs[i], c.argcs[i]);
+    free(c.argcs);
+    free(c.argvs);
+    free(c.text);
+    free(c.work);
+    cl_result_free(c.r);
+    cl_free(c.p);
+    free_names(names, 16);
+}
+
+// response file and list decoding
+
+typedef struct {
+    Clargs *p;
+    ClResult *r;
+    int argc;
+    char **argv;
+} RespCtx;
+
+static void run_resp(void *ctx, long iters) {
+    RespCtx *c = (RespCtx*)ctx;
+    for (long i=0;i<iters;i++) cl_parse_r(c->p, c->r, c->argc, c->argv);
+}
+
+static void bench_response(void) {
+    enum { ENTRIES = 1000000 };
+    char name[128], path[] = "/tmp/clargs-bench-XXXXXX", at[64];
+    name_of(name, sizeof name, "response/entries=%d", ENTRIES);
+    int want_file = wanted(name) || wanted("response/heap") || wanted("response/borrow");
+    if (!want_file) return;
+    int fd = mkstemp(path);
+    if (fd < 0) return;
+    FILE *f = fdopen(fd, "w");
+    for (int i=0;i<ENTRIES;i++) fprintf(f, "/data/set%03d/file%07d.dat\n", i % 1000, i);
+    fclose(f);
+    snprintf(at, sizeof at, "@%s", path);
+    for (int m=0;m<3;m += 2) {
+        Clargs *p = cl_create_ex("bench", "", mode_flags[m] | CL_RESPONSE);
+        cl_add_flag(p, 'v', "verbose", "");
+        cl_add_pos_list(p, "files", "", 1);
+        cl_freeze(p);
+        RespCtx c;
+        char *argv[] = { (char*)"bench", at, NULL };
+        c.p = p; c.r = cl_result_new(p); c.argc = 2; c.argv = argv;
+        name_of(name, sizeof name, "response/%s/entries=%d", mode_name[m], ENTRIES);
+        if (wanted(name)) {
+            size_t live = bench_live;
+            bench_peak = live;
+            BenchStat st = bench_time(run_resp, &c);
+            emit(name, st.ns, ENTRIES, st.allocs, (double)(bench_peak - live));
+        }
+        cl_result_free(c.r);
+        cl_free(p);
+    }
+    unlink(path);
+}
+
+static void bench_lists(void) {
+    enum { ELEMS = 100000 };
+    static const struct { const char *name; ArgKind kind; } kinds[] = {
+        { "int", ARG_INT }, { "ullong", ARG_ULLONG }, { "double", ARG_DOUBLE }, { "string", ARG_STRING },
+    };
+    char name[128];
+    for (int k=0;k<4;k++) {
+        name_of(name, sizeof name, "list/%s/elems=%d", kinds[k].name, ELEMS);
+        if (!wanted(name)) continue;
+        char *val = (char*)malloc(ELEMS * 24);
+        size_t n = 0;
+        for (int i=0;i<ELEMS;i++) {
+            if (i) val[n++] = ',';
+            switch (kinds[k].kind) {
+                case ARG_DOUBLE: n += sprintf(val + n, "%u.%03u", rnd(100000), rnd(1000)); break;
+                case ARG_STRING: n += sprintf(val + n, "tag%u", rnd(100000)); break;
+                case ARG_ULLONG: n += sprintf(val + n, "%llu", (unsigned long long)rnd(1000000000) * 1000000007ull); break;
+                default: n += sprintf(val + n, "%d", (int)rnd(2000000000) - 1000000000); break;
+            }
+        }
+        val[n] = 0;
+        Clargs *p = cl_create_ex("bench", "", CL_ARENA);
+        cl_add_list(p, 'i', "items", NULL, "", 0, kinds[k].kind);
+        cl_freeze(p);
+        char *argv[] = { (char*)"bench", (char*)"--items", val, NULL };
+        RespCtx c;
+        c.p = p; c.r = cl_result_new(p); c.argc = 3; c.argv = argv;
+        BenchStat st = bench_time(run_resp, &c);
+        emit(name, st.ns, ELEMS, st.allocs, -1);
+        cl_result_free(c.r);
+        cl_free(p);
+        free(val);
+    }
+}
+
+// startup cost when a program reads only a few of many options: every
+// option is given once, then five are read
+
+typedef struct {
+    Clargs *p;
+    ClResult *r;
+    int argc;
+    char **argv;
+    volatile double sink;
+} LazyCtx;
+
+static void run_lazy(void *ctx, long iters) {
+    LazyCtx *c = (LazyCtx*)ctx;
+    double s = 0;
+    for (long i=0;i<iters;i++) {
+        cl_parse_r(c->p, c->r, c->argc, c->argv);
+        s += cl_rget_int(c->r, 0, NULL) + cl_rget_int(c->r, 100, NULL) + cl_rget_double(c->r, 203, NULL);
+        s += cl_rget_string(c->r, 301)[0] + cl_rget_string(c->r, 497)[0];
+    }
+    c->sink = s;
+}
+
+static void bench_lazy(void) {
+    enum { OPTS = 500 };
+    static const char *const how[] = { "strict", "lazy" };
+    char name[128];
+    char **names = make_names(OPTS);
+    // every option once, in random order
+    char **argv = (char**)malloc((2 * OPTS + 2) * sizeof(char*));
+    int order[OPTS], argc = 0;
+    for (int i=0;i<OPTS;i++) order[i] = i;
+    for (int i=OPTS-1;i>0;i--) { int j = (int)rnd((unsigned)i + 1), t = order[i]; order[i] = order[j]; order[j] = t; }
+    argv[argc++] = (char*)"bench";
+    for (int k=0;k<OPTS;k++) {
+        int i = order[k];
+        char *tok = (char*)malloc(24);
+        snprintf(tok, 24, "--opt%d", i);
+        argv[argc++] = tok;
+        if (i % 4 == 2) continue;
+        char *val = (char*)malloc(24);
+        switch (i % 4) {
+            case 0: snprintf(val, 24, "%u", rnd(1000000)); break;
+            case 1: snprintf(val, 24, "value%u", rnd(1000)); break;
+            default: snprintf(val, 24, "%u.%u", rnd(1000), rnd(100)); break;
+        }
+        argv[argc++] = val;
+    }
+    argv[argc] = NULL;
+    for (int m=0;m<3;m+=2) {
+        for (int l=0;l<2;l++) {
+            name_of(name, sizeof name, "lazy/%s/%s/opts=%d/read=5", how[l], mode_name[m], OPTS);
+            if (!wanted(name)) continue;
+            LazyCtx c;
+            c.p = make_spec(OPTS, mode_flags[m] | (l ? CL_LAZY : 0), names);
+            c.r = cl_result_new(c.p);
+            c.argc = argc;
+            c.argv = argv;
+            BenchStat st = bench_time(run_lazy, &c);
+            emit(name, st.ns, argc - 1, st.allocs, -1);
+            cl_result_free(c.r);
+            cl_free(c.p);
+        }
+    }
+    free_argv(argv, argc);
+    free_names(names, OPTS);
+}
+
+// abbreviations and typo suggestions over large specs
+
+typedef struct {
+    Clargs *p;
+    char **names;
+    int n;
+    char q[24];
+    volatile long sink;
+} NameCtx;
+
+static void run_prefix(void *ctx, long iters) {
+    NameCtx *c = (NameCtx*)ctx;
+    long s = 0;
+    for (long i=0, k=0;i<iters;i++, k = k + 1 < c->n ? k + 1 : 0) s += cl_prefix(c->p, c->names[k], strlen(c->names[k]) - 1);
+    c->sink = s;
+}
+
+static void run_suggest(void *ctx, long iters) {
+    NameCtx *c = (NameCtx*)ctx;
+    long s = 0;
+    for (long i=0, k=0;i<iters;i++, k = k + 1 < c->n ? k + 1 : 0) {
+        // the name with its first two characters swapped
+        size_t len = strlen(c->names[k]);
+        memcpy(c->q, c->names[k], len + 1);
+        c->q[0] = c->names[k][1];
+        c->q[1] = c->names[k][0];
+        s += cl_suggest(c->p, c->q, len);
+    }
+    c->sink = s;
+}
+
+static void bench_names(void) {
+    static const int opts[] = { 100, 1000, 10000 };
+    char name[128];
+    for (int o=0;o<3;o++) {
+        NameCtx c;
+        c.names = make_names(opts[o]);
+        c.n = opts[o];
+        c.p = make_spec(opts[o], CL_ABBREV, c.names);
+        name_of(name, sizeof name, "names/prefix/opts=%d", opts[o]);
+        if (wanted(name)) {
+            BenchStat st = bench_time(run_prefix, &c);
+            emit(name, st.ns, -1, st.allocs, -1);
+        }
+        name_of(name, sizeof name, "names/suggest/opts=%d", opts[o]);
+        if (wanted(name)) {
+            BenchStat st = bench_time(run_suggest, &c);
+            emit(name, st.ns, -1, st.allocs, -1);
+        }
+        cl_free(c.p);
+        free_names(c.names, opts[o]);
+    }
+}
+
+// help rendering and completion queries
+
+typedef struct {
+    Clargs *p;
+    ClBuf out;
+    volatile size_t sink;
+} HelpCtx;
+
+static void run_help_render(void *ctx, long iters) {
+    HelpCtx *c = (HelpCtx*)ctx;
+    size_t s = 0, n;
+    for (long i=0;i<iters;i++) {
+        c->p->help_count = -1;      // drop the cached text
+        cl_help_text(c->p, &n);
+        s += n;
+    }
+    c->sink = s;
+}
+
+static void run_help_cached(void *ctx, long iters) {
+    HelpCtx *c = (HelpCtx*)ctx;
+    size_t s = 0, n;
+    for (long i=0;i<iters;i++) { cl_help_text(c->p, &n); s += n; }
+    c->sink = s;
+}
+
+static void run_complete(void *ctx, long iters) {
+    HelpCtx *c = (HelpCtx*)ctx;
+    size_t s = 0;
+    for (long i=0;i<iters;i++) {
+        c->out.n = 0;
+        cl_complete_text(c->p, "--opt3", &c->out);
+        s += c->out.n;
+    }
+    c->sink = s;
+}
+
+static void bench_help(void) {
+    static const int opts[] = { 40, 400, 4000 };
+    static const struct { const char *name; BenchFn fn; } runs[] = {
+        { "help/render", run_help_render }, { "help/cached", run_help_cached }, { "complete/query", run_complete },
+    };
+    char name[128];
+    for (int o=0;o<3;o++) {
+        char **names = make_names(opts[o]);
+        HelpCtx c;
+        memset(&c, 0, sizeof c);
+        c.p = make_spec(opts[o], 0, names);
+        for (int k=0;k<3;k++) {
+            name_of(name, sizeof name, "%s/opts=%d", runs[k].name, opts[o]);
+            if (!wanted(name)) continue;
+            BenchStat st = bench_time(runs[k].fn, &c);
+            emit(name, st.ns, -1, st.allocs, -1);
+        }
+        free(c.out.s);
+        cl_free(c.p);
+        free_names(names, opts[o]);
+    }
+}
+
+// subcommands: startup of a program with 60 subcommands of 40 options each,
+// every iteration creating, parsing and freeing the spec. Flat adds all
+// 2400 options up front; lazy registers builders and builds only the
+// selected subcommand
+
+enum { CMDS = 60, CMD_OPTS = 40 };
+
+typedef struct {
+    char **names;
+    char *cmds[CMDS];
+    char **argv;
+    volatile long sink;
+} CmdCtx;
+
+static void build_cmd(Clargs *s, void *ud) {
+    char **names = (char**)ud;
+    for (int i=0;i<CMD_OPTS;i++) {
+        switch (i % 4) {
+            case 0: cl_add_int(s, 0, names[i], NULL, "an int", 0, 1); break;
+            case 1: cl_add_string(s, 0, names[i], NULL, "a string", 0, "default"); break;
+            case 2: cl_add_flag(s, 0, names[i], "a flag"); break;
+            default: cl_add_double(s, 0, names[i], NULL, "a double", 0, 0.5); break;
+        }
+    }
+}
+
+static void run_cmd_flat(void *ctx, long iters) {
+    CmdCtx *c = (CmdCtx*)ctx;
+    long s = 0;
+    for (long i=0;i<iters;i++) {
+        Clargs *p = make_spec(CMDS * CMD_OPTS, 0, c->names);
+        cl_parse(p, 4, c->argv);
+        s += cl_get_int_at(p, 7 * CMD_OPTS + 4, NULL);
+        cl_free(p);
+    }
+    c->sink = s;
+}
+
+static void run_cmd_lazy(void *ctx, long iters) {
+    CmdCtx *c = (CmdCtx*)ctx;
+    long s = 0;
+    for (long i=0;i<iters;i++) {
+        Clargs *p = cl_create_ex("bench", "benchmark spec", 0);
+        for (int k=0;k<CMDS;k++) cl_add_cmd(p, c->cmds[k], "a subcommand", build_cmd, c->names);
+        cl_parse(p, 5, c->argv);
+        s += cl_get_int_at(cl_cmd_args(p), 4, NULL);
+        cl_free(p);
+    }
+    c->sink = s;
+}
+
+static void bench_commands(void) {
+    static const struct { const char *name; BenchFn fn; } runs[] = {
+        { "cmd/startup/flat", run_cmd_flat }, { "cmd/startup/lazy", run_cmd_lazy },
+    };
+    char name[128];
+    CmdCtx c;
+    memset(&c, 0, sizeof c);
+    c.names = make_names(CMDS * CMD_OPTS);
+    for (int k=0;k<CMDS;k++) {
+        c.cmds[k] = (char*)malloc(16);
+        snprintf(c.cmds[k], 16, "cmd%d", k);
+    }
+    // the same two options of subcommand 7, under their flat names
+    char *flat[] = { (char*)"bench", (char*)"--opt284", (char*)"12", (char*)"--opt282", NULL };
+    char *cmd[] = { (char*)"bench", c.cmds[7], (char*)"--opt4", (char*)"12", (char*)"--opt2", NULL };
+    for (int k=0;k<2;k++) {
+        name_of(name, sizeof name, "%s/cmds=%d/opts=%d", runs[k].name, CMDS, CMD_OPTS);
+        if (!wanted(name)) continue;
+        c.argv = k ? cmd : flat;
+        BenchStat st = bench_time(runs[k].fn, &c);
+        emit(name, st.ns, -1, st.allocs, -1);
+    }
+    for (int k=0;k<CMDS;k++) free(c.cmds[k]);
+    free_names(c.names, CMDS * CMD_OPTS);
+}
+
+// constraints: parsing against 1000 options with no rules and with 300
+// rules of every kind, all of them satisfied so each one is checked
+
+static void bench_rules(void) {
+    enum { OPTS = 1000 };
+    char name[128];
+    char **names = make_names(OPTS);
+    // options 0..7 given, every kind once per four
+    char *argv[] = { (char*)"bench", (char*)"--opt0", (char*)"1", (char*)"--opt1", (char*)"x", (char*)"--opt2", (char*)"--opt3", (char*)"0.5",
+                     (char*)"--opt4", (char*)"2", (char*)"--opt5", (char*)"y", (char*)"--opt6", (char*)"--opt7", (char*)"1.5", NULL };
+    for (int n=0;n<=300;n+=300) {
+        name_of(name, sizeof name, "rules/opts=%d/rules=%d", OPTS, n);
+        if (!wanted(name)) continue;
+        Clargs *p = make_spec(OPTS, 0, names);
+        for (int k=0;k<n/6;k++) {
+            int any[4] = { k % 8, 100 + k, 300 + k, 700 + k }, one[3] = { k % 8, 200 + k, 600 + k };
+            cl_requires(p, 100 + k, 101 + k);
+            cl_requires(p, 400 + k, 900 + k);
+            cl_conflicts(p, k % 8, 500 + k);
+            cl_conflicts(p, 800 + k, 850 + k);
+            cl_at_least_one_of(p, any, 4);
+            cl_exactly_one_of(p, one, 3);
+        }
+        ParseCtx c = { p, cl_result_new(p), 15, argv };
+        BenchStat st = bench_time(run_parse_r, &c);
+        emit(name, st.ns, -1, st.allocs, -1);
+        cl_result_free(c.r);
+        cl_free(p);
+    }
+    free_names(names, OPTS);
+}
+
+// snapshots: a worker getting the parent's options by parsing the same
+// argv against the same 500-option spec, against mapping a snapshot of
+// the parsed result with and without building the spec to fingerprint it
+
+enum { SNAP_OPTS = 500 };
+
+typedef struct {
+    char **names;
+    int argc;
+    char **argv;
+    ClResult *r;
+    uint64_t spec;
+    int fd;
+    volatile long sink;
+} SnapCtx;
+
+static void run_snap_parse(void *ctx, long iters) {
+    SnapCtx *c = (SnapCtx*)ctx;
+    long s = 0;
+    for (long i=0;i<iters;i++) {
+        Clargs *p = make_spec(SNAP_OPTS, 0, c->names);
+        cl_parse(p, c->argc, c->argv);
+        s += cl_get_int_at(p, 4, NULL) + (long)strlen(cl_get_string_at(p, 5));
+        cl_free(p);
+    }
+    c->sink = s;
+}
+
+static void snap_read(SnapCtx *c, uint64_t spec) {
+    ClSnap m;
+    if (cl_snap_map(&m, spec, c->fd) != CL_OK) return;
+    c->sink += cl_snap_value(&m, 4)->i + (long)strlen(cl_snap_string(&m, 5));
+    cl_snap_close(&m);
+}
+
+static void run_snap_spec_map(void *ctx, long iters) {
+    SnapCtx *c = (SnapCtx*)ctx;
+    for (long i=0;i<iters;i++) {
+        Clargs *p = make_spec(SNAP_OPTS, 0, c->names);
+        snap_read(c, cl_spec_hash(p));
+        cl_free(p);
+    }
+}
+
+static void run_snap_map(void *ctx, long iters) {
+    SnapCtx *c = (SnapCtx*)ctx;
+    for (long i=0;i<iters;i++) snap_read(c, c->spec);
+}
+
+static void run_snap_write(void *ctx, long iters) {
+    SnapCtx *c = (SnapCtx*)ctx;
+    for (long i=0;i<iters;i++) {
+        size_t len;
+        void *s = cl_snapshot(c->r, &len);
+        c->sink += (long)len;
+        free(s);
+    }
+}
+
+static void bench_snapshot(void) {
+    static const struct { const char *name; BenchFn fn; } runs[] = {
+        { "snap/startup/parse", run_snap_parse }, { "snap/startup/spec+map", run_snap_spec_map },
+        { "snap/startup/map", run_snap_map }, { "snap/write", run_snap_write },
+    };
+    char name[128];
+    SnapCtx c;
+    memset(&c, 0, sizeof c);
+    c.names = make_names(SNAP_OPTS);
+    c.argv = make_argv(SNAP_OPTS, 400, &c.argc);
+    // the parent: parse once, keep the snapshot in a memfd
+    Clargs *p = make_spec(SNAP_OPTS, 0, c.names);
+    c.r = cl_result_new(p);
+    cl_parse_r(p, c.r, c.argc, c.argv);
+    c.spec = cl_spec_hash(p);
+    c.fd = cl_snapshot_fd(c.r);
+    for (int k=0;k<4 && c.fd >= 0;k++) {
+        name_of(name, sizeof name, "%s/opts=%d/argc=%d", runs[k].name, SNAP_OPTS, c.argc);
+        if (!wanted(name)) continue;
+        BenchStat st = bench_time(runs[k].fn, &c);
+        emit(name, st.ns, -1, st.allocs, -1);
+    }
+    if (c.fd >= 0) close(c.fd);
+    cl_result_free(c.r);
+    cl_free(p);
+    free_argv(c.argv, c.argc);
+    free_names(c.names, SNAP_OPTS);
+}
+
+// layered sources: filling 500 options from a config file read as text,
+// from its binary cache, and 50 of them from environment variables
+
+static void run_layers(void *ctx, long iters) {
+    ParseCtx *c = (ParseCtx*)ctx;
+    for (long i=0;i<iters;i++) cl_parse_layers(c->p, c->r, c->argc, c->argv);
+}
+
+static void bench_layers(void) {
+    enum { OPTS = 500, VARS = 50 };
+    static const char *const runs[] = { "layers/config/text", "layers/config/cache", "layers/env" };
+    char name[128], conf[] = "/tmp/clargs-bench-XXXXXX", cache[64];
+    char *argv[] = { (char*)"bench", NULL };
+    char **names = make_names(OPTS);
+    int fd = mkstemp(conf);
+    if (fd < 0) return;
+    FILE *f = fdopen(fd, "w");
+    for (int i=0;i<OPTS;i++) {
+        switch (i % 4) {
+            case 0: fprintf(f, "opt%d = %u\n", i, rnd(1000000)); break;
+            case 1: fprintf(f, "opt%d = \"value %u\"\n", i, rnd(1000)); break;
+            case 2: fprintf(f, "opt%d = true\n", i); break;
+            default: fprintf(f, "opt%d = %u.%u  # a comment\n", i, rnd(1000), rnd(100)); break;
+        }
+    }
+    fclose(f);
+    snprintf(cache, sizeof cache, "%s.cache", conf);
+    for (int i=0;i<VARS;i++) {
+        char var[32], val[16];
+        snprintf(var, sizeof var, "BENCH_OPT%d", i * 10);
+        snprintf(val, sizeof val, "%d", i);
+        setenv(var, val, 1);
+    }
+    for (int k=0;k<3;k++) {
+        name_of(name, sizeof name, "%s/opts=%d/%s=%d", runs[k], OPTS, k == 2 ? "vars" : "keys", k == 2 ? VARS : OPTS);
+        if (!wanted(name)) continue;
+        Clargs *p = make_spec(OPTS, 0, names);
+        cl_sources(p, k == 2 ? "BENCH" : NULL, k == 2 ? NULL : conf, k == 1 ? cache : NULL);
+        ParseCtx c = { p, cl_result_new(p), 1, argv };
+        BenchStat st = bench_time(run_layers, &c);
+        emit(name, st.ns, OPTS, st.allocs, -1);
+        cl_result_free(c.r);
+        cl_free(p);
+    }
+    for (int i=0;i<VARS;i++) {
+        char var[32];
+        snprintf(var, sizeof var, "BENCH_OPT%d", i * 10);
+        unsetenv(var);
+    }
+    unlink(cache);
+    unlink(conf);
+    free_names(names, OPTS);
+}
+
+// numeric conversion against libc
+
+enum { NUMS = 4096 };
+
+typedef struct {
+    char vals[NUMS][32];
+    volatile double sink;
+} NumCtx;
+
+static void run_conv_int(void *ctx, long iters) {
+    NumCtx *c = (NumCtx*)ctx;
+    long s = 0;
+    for (long i=0;i<iters;i++) { int v = 0; cl_convert_int(&v, ARG_INT, c->vals[i & (NUMS - 1)]); s += v; }
+    c->sink = (double)s;
+}
+
+static void run_strtol(void *ctx, long iters) {
+    NumCtx *c = (NumCtx*)ctx;
+    long s = 0;
+    for (long i=0;i<iters;i++) s += strtol(c->vals[i & (NUMS - 1)], NULL, 10);
+    c->sink = (double)s;
+}
+
+static void run_conv_double(void *ctx, long iters) {
+    NumCtx *c = (NumCtx*)ctx;
+    double s = 0;
+    for (long i=0;i<iters;i++) { double v = 0; cl_convert_float(&v, 0, c->vals[i & (NUMS - 1)]); s += v; }
+    c->sink = s;
+}
+
+static void run_strtod(void *ctx, long iters) {
+    NumCtx *c = (NumCtx*)ctx;
+    double s = 0;
+    for (long i=0;i<iters;i++) s += strtod(c->vals[i & (NUMS - 1)], NULL);
+    c->sink = s;
+}
+
+static void run_conv_float(void *ctx, long iters) {
+    NumCtx *c = (NumCtx*)ctx;
+    double s = 0;
+    for (long i=0;i<iters;i++) { float v = 0; cl_convert_float(&v, 1, c->vals[i & (NUMS - 1)]); s += v; }
+    c->sink = s;
+}
+
+static void run_strtof(void *ctx, long iters) {
+    NumCtx *c = (NumCtx*)ctx;
+    double s = 0;
+    for (long i=0;i<iters;i++) s += strtof(c->vals[i & (NUMS - 1)], NULL);
+    c->sink = s;
+}
+
+static void bench_numeric(void) {
+    static const struct { const char *name; BenchFn fn; int fl; } runs[] = {
+        { "numeric/int/clargs", run_conv_int, 0 }, { "numeric/int/strtol", run_strtol, 0 },
+        { "numeric/double/clargs", run_conv_double, 1 }, { "numeric/double/strtod", run_strtod, 1 },
+        { "numeric/float/clargs", run_conv_float, 1 }, { "numeric/float/strtof", run_strtof, 1 },
+    };
+    NumCtx *c = (NumCtx*)malloc(sizeof(NumCtx));
+    for (int k=0;k<6;k++) {
+        if (!wanted(runs[k].name)) continue;
+        for (int i=0;i<NUMS;i++) {
+            if (runs[k].fl) snprintf(c->vals[i], 32, "%.*g", 1 + (int)rnd(9), (rnd(2000000) - 1000000.0) / (1 + rnd(1000)));
+            else snprintf(c->vals[i], 32, "%d", (int)rnd(2000000000) - 1000000000);
+        }
+        BenchStat st = bench_time(runs[k].fn, c);
+        emit(runs[k].name, st.ns, -1, -1, -1);
+    }
+    free(c);
+}
+
+// cold start: fork/exec a minimal binary and keep the median
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void bench_coldstart(const char *dir) {
+    static const char *const bins[] = { "coldstart", "coldstart_empty" };
+    enum { RUNS = 200 };
+    char name[128], path[4096];
+    for (int b=0;b<2;b++) {
+        name_of(name, sizeof name, "coldstart/%s", bins[b]);
+        if (!wanted(name)) continue;
+        snprintf(path, sizeof path, "%s/%s", dir, bins[b]);
+        if (access(path, X_OK) != 0) continue;
+        double t[RUNS];
+        for (int i=0;i<RUNS;i++) {
+            double s = now_ns();
+            pid_t pid = fork();
+            if (pid == 0) {
+                char *argv[] = { path, (char*)"-v", (char*)"--count", (char*)"3", (char*)"input.txt", NULL };
+                execv(path, argv);
+                _exit(127);
+            }
+            int status;
+            waitpid(pid, &status, 0);
+            t[i] = now_ns() - s;
+        }
+        qsort(t, RUNS, sizeof(double), cmp_double);
+        emit(name, t[RUNS / 2], -1, -1, -1);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *ms = getenv("BENCH_MS");
+    const char *commit = getenv("BENCH_COMMIT");
+    if (ms && atof(ms) > 0) bench_ms = atof(ms);
+    if (argc > 1) bench_filter = argv[1];
+    // cl_parse prints nothing for well-formed input, but keep stray
+    // messages out of the JSON stream
+    freopen("/dev/null", "w", stderr);
+    char dir[4096];
+    snprintf(dir, sizeof dir, "%s", argv[0]);
+    char *slash = strrchr(dir, '/');
+    if (slash) *slash = 0; else strcpy(dir, ".");
+
+#ifdef CLARGS_STATS
+    int stats = 1;
+#else
+    int stats = 0;
+#endif
+    printf("{\"name\":\"meta\",\"commit\":\"%s\",\"alloc_hooked\":%d,\"bench_ms\":%.0f,\"stats\":%d}\n", commit ? commit : "", bench_alloc_hooked, bench_ms, stats);
+    bench_parse();
+    bench_threads();
+    bench_getters();
+    bench_memory();
+    bench_batch();
+    bench_response();
+    bench_lists();
+    bench_lazy();
+    bench_names();
+    bench_help();
+    bench_commands();
+    bench_rules();
+    bench_snapshot();
+    bench_layers();
+    bench_numeric();
+    bench_coldstart(dir);
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    printf("{\"name\":\"bench/maxrss\",\"ns_per_op\":0,\"maxrss_kb\":%ld}\n", ru.ru_maxrss);
+    return 0;
+}
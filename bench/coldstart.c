@@ -0,0 +1,22 @@
+// minimal program for the cold-start benchmark; built once as is and once
+// with COLDSTART_EMPTY so the difference is the library's share
+
+#ifndef COLDSTART_EMPTY
+#include "clargs.h"
+#endif
+
+int main(int argc, char **argv) {
+#ifdef COLDSTART_EMPTY
+    (void)argc; (void)argv;
+    return 0;
+#else
+    Clargs *args = cl_create("coldstart", "cold start benchmark");
+    cl_add_flag(args, 'v', "verbose", "Verbose output");
+    cl_add_int(args, 'c', "count", "N", "Repeat count", 0, 1);
+    cl_add_string(args, 'o', "output", "FILE", "Output file", 0, "out.txt");
+    cl_add_pos(args, "input", "Input file", 1);
+    int rc = cl_parse(args, argc, argv);
+    cl_free(args);
+    return rc ? 1 : 0;
+#endif
+}
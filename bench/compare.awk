@@ -0,0 +1,30 @@
+# compares two bench result files line by line on "name":
+#   awk -f compare.awk old.jsonl new.jsonl
+# prints old and new ns_per_op (and allocs_per_op) with the ratio new/old
+
+function field(line, key,    m) {
+    if (match(line, "\"" key "\":(\"[^\"]*\"|[-0-9.e+]+)")) {
+        m = substr(line, RSTART + length(key) + 3, RLENGTH - length(key) - 3)
+        gsub(/"/, "", m)
+        return m
+    }
+    return ""
+}
+
+FNR == NR {
+    name = field($0, "name")
+    old_ns[name] = field($0, "ns_per_op")
+    old_al[name] = field($0, "allocs_per_op")
+    next
+}
+
+{
+    name = field($0, "name")
+    if (name == "meta" || !(name in old_ns)) next
+    ns = field($0, "ns_per_op")
+    al = field($0, "allocs_per_op")
+    ratio = old_ns[name] > 0 ? ns / old_ns[name] : 0
+    printf "%-48s %12.1f %12.1f  x%.3f", name, old_ns[name], ns, ratio
+    if (al != "" && old_al[name] != "") printf "   allocs %s -> %s", old_al[name], al
+    printf "\n"
+}
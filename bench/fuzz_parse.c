@@ -0,0 +1,171 @@
+// fuzz harness for the parser.
+//
+// libFuzzer:  clang -g -O1 -fsanitize=fuzzer,address,undefined -I.. fuzz_parse.c
+// AFL:        afl-clang-fast -g -O1 -DFUZZ_STANDALONE -I.. fuzz_parse.c
+//             (reads one input from stdin, or from each file argument)
+//
+// The first input byte picks the allocation mode and what to drive; the
+// rest is split on NUL bytes into argv, fed to cl_parse_lines as a line
+// buffer, written to a file and passed as @file, or opened as a snapshot
+// with cl_snap_open and read back through every cl_snap_* getter.
+
+#define CLARGS_THREADS
+#include "clargs.h"
+#include <stdio.h>
+#include <stdint.h>
+
+static Clargs *specs[3];
+static char resp_path[] = "/tmp/clargs-fuzz-XXXXXX";
+static int resp_fd = -1;
+
+static Clargs *make_spec(int flags) {
+    Clargs *p = cl_create_ex("fuzz", "fuzz spec", flags | CL_RESPONSE | (flags & CL_ARENA ? CL_ABBREV : 0));
+    cl_add_flag(p, 'v', "verbose", "flag");
+    cl_add_string(p, 's', "str", NULL, "string", 0, "def");
+    cl_add_char(p, 'c', "chr", NULL, "char", 0, 'x');
+    cl_add_short(p, 'h', "short", NULL, "short", 0, 1);
+    cl_add_int(p, 'i', "int", NULL, "int", 0, 2);
+    cl_add_long(p, 'l', "long", NULL, "long", 0, 3);
+    cl_add_llong(p, 'L', "llong", NULL, "llong", 0, 4);
+    cl_add_uchar(p, 'u', "uchar", NULL, "uchar", 0, 5);
+    cl_add_ushort(p, 'U', "ushort", NULL, "ushort", 0, 6);
+    cl_add_uint(p, 'n', "uint", NULL, "uint", 0, 7);
+    cl_add_ulong(p, 'N', "ulong", NULL, "ulong", 0, 8);
+    cl_add_ullong(p, 'q', "ullong", NULL, "ullong", 0, 9);
+    cl_add_size(p, 'z', "size", NULL, "size", 0, 10);
+    cl_add_float(p, 'f', "float", NULL, "float", 0, 1.5f);
+    cl_add_double(p, 'd', "double", NULL, "double", 1, 2.5);
+    cl_add_list(p, 'I', "ints", NULL, "int list", 0, ARG_INT);
+    cl_add_list(p, 'D', "doubles", NULL, "double list", 0, ARG_DOUBLE);
+    cl_add_list(p, 'S', "strs", NULL, "string list", 0, ARG_STRING);
+    cl_add_list(p, 'Z', "sizes", NULL, "size list", 0, ARG_SIZE);
+    cl_add_list(p, 'K', "llongs", NULL, "llong list", 0, ARG_LLONG);
+    cl_add_pos(p, "first", "positional", 0);
+    cl_add_pos_list(p, "rest", "remaining", 0);
+    cl_freeze(p);
+    return p;
+}
+
+static void init(void) {
+    static const int flags[3] = { 0, CL_ARENA, CL_BORROW };
+    for (int m=0;m<3;m++) specs[m] = make_spec(flags[m]);
+    resp_fd = mkstemp(resp_path);
+    // cl_perror is exercised but its output is not interesting
+    freopen("/dev/null", "w", stderr);
+}
+
+// reads every value so the sanitizers see each stored pointer
+static void touch(const Clargs *p, const ClResult *r, char **argv) {
+    volatile size_t sink = 0;
+    for (int h=0;h<p->count;h++) {
+        int n;
+        const void *list = cl_rget_list(r, h, &n);
+        if (list && (p->args[h].kind == ARG_STRING || p->args[h].kind == ARG_POSITIONAL))
+            for (int i=0;i<n;i++) sink += strlen(((const char *const *)list)[i]);
+        else if (list) sink += ((const unsigned char*)list)[n * cl_kind_size[p->args[h].kind] - 1];
+        if (cl_is_str(&p->args[h]) && r->vals[h].str) sink += strlen(r->vals[h].str);
+    }
+    if (r->err < 0) cl_perror(p, r, argv);
+    (void)sink;
+}
+
+// as a snapshot: once as given, and once with the magic, ABI and spec
+// hash patched in so the layout checks behind them are reached too
+static void snap(const Clargs *p, const uint8_t *data, size_t size) {
+    uint64_t *buf = (uint64_t*)malloc(size / 8 * 8 + 8);
+    volatile size_t sink = 0;
+    memcpy(buf, data, size);
+    for (int pass=0;pass<2;pass++) {
+        ClSnap sn;
+        if (pass && size >= sizeof(ClSnapHead)) {
+            ClSnapHead *hd = (ClSnapHead*)buf;
+            memcpy(hd->magic, "CLARGSv1", 8);
+            hd->abi = cl_snap_abi();
+            hd->spec = cl_spec_hash(p);
+        } else if (pass) break;
+        if (cl_snap_open(&sn, cl_spec_hash(p), buf, size) != CL_OK) continue;
+        for (int h=-1;h<=sn.count;h++) {
+            int n;
+            const ClValue *v = cl_snap_value(&sn, h);
+            const char *str = cl_snap_string(&sn, h), *e;
+            const unsigned char *list = (const unsigned char*)cl_snap_list(&sn, h, &n);
+            sink += cl_snap_flag(&sn, h) + (v ? v->uc : 0) + (str ? strlen(str) : 0);
+            if (list) sink += list[(size_t)n * cl_kind_size[cl_snap_kind(&sn, h) & 0x7f] - 1];
+            for (int i=0;(e = cl_snap_list_string(&sn, h, i));i++) sink += strlen(e);
+        }
+        cl_snap_close(&sn);
+    }
+    free(buf);
+    (void)sink;
+}
+
+static int on_line(const ClResult *r, int line, int status, int argc, char **argv, void *ud) {
+    (void)line; (void)status; (void)argc; (void)ud;
+    touch(r->spec, r, argv);
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (!specs[0]) init();
+    if (size < 1) return 0;
+    int mode = data[0] % 3, what = (data[0] / 3) % 4;
+    const Clargs *p = specs[mode];
+    data++; size--;
+    char *buf = (char*)malloc(size + 1);
+    memcpy(buf, data, size);
+    buf[size] = 0;
+    ClResult *r = cl_result_new(p);
+
+    if (what == 0) {
+        char *argv[66];
+        int argc = 0;
+        argv[argc++] = (char*)"fuzz";
+        for (size_t i=0;i<=size && argc<65;) {
+            argv[argc++] = buf + i;
+            i += strlen(buf + i) + 1;
+        }
+        argv[argc] = NULL;
+        cl_parse_r(p, r, argc, argv);
+        touch(p, r, argv);
+    } else if (what == 1) {
+        cl_parse_lines(p, r, buf, size, on_line, NULL);
+    } else if (what == 3) {
+        snap(p, data, size);
+    } else if (resp_fd >= 0) {
+        char at[64];
+        snprintf(at, sizeof at, "@%s", resp_path);
+        if (ftruncate(resp_fd, 0) == 0 && pwrite(resp_fd, data, size, 0) == (ssize_t)size) {
+            char *argv[] = { (char*)"fuzz", at, NULL };
+            cl_parse_r(p, r, 2, argv);
+            touch(p, r, argv);
+        }
+    }
+
+    cl_result_free(r);
+    free(buf);
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+static void run_file(FILE *f) {
+    size_t cap = 1 << 16, n = 0, got;
+    uint8_t *data = (uint8_t*)malloc(cap);
+    while ((got = fread(data + n, 1, cap - n, f)) > 0) {
+        n += got;
+        if (n == cap) data = (uint8_t*)realloc(data, cap *= 2);
+    }
+    LLVMFuzzerTestOneInput(data, n);
+    free(data);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) { run_file(stdin); return 0; }
+    for (int i=1;i<argc;i++) {
+        FILE *f = fopen(argv[i], "rb");
+        if (!f) continue;
+        run_file(f);
+        fclose(f);
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,227 @@
+// checks clargs.hpp against the C parser: a CLARGS_STRUCT and the same
+// options built with cl_add_* parse generated command lines, and the
+// status, error detail, presence and every value must agree, as must the
+// help text and error messages printed through the C bridge. Exits
+// non-zero on any difference.
+
+#include "clargs.hpp"
+#include <stdio.h>
+#include <string>
+
+#define CHECK_OPTS(X) \
+    X('v', verbose, "verbose", ARG_FLAG,       0,        0, "a flag") \
+    X('s', name,    "name",    ARG_STRING,     "anon",   0, "a string") \
+    X('c', letter,  "letter",  ARG_CHAR,       'x',      0, "a char") \
+    X('S', small,   "small",   ARG_SHORT,      -3,       0, "a short") \
+    X('i', count,   "count",   ARG_INT,        8080,     0, "an int") \
+    X('l', big,     "big",     ARG_LONG,       -70000,   0, "a long") \
+    X('L', huge,    "huge",    ARG_LLONG,      1,        0, "a long long") \
+    X('u', level,   "level",   ARG_UCHAR,      5,        0, "an unsigned char") \
+    X('U', port,    "port",    ARG_USHORT,     443,      0, "an unsigned short") \
+    X('n', items,   "items",   ARG_UINT,       7,        0, "an unsigned int") \
+    X('N', total,   "total",   ARG_ULONG,      8,        0, "an unsigned long") \
+    X('q', seed,    "seed",    ARG_ULLONG,     9,        0, "an unsigned long long") \
+    X('z', bytes,   "bytes",   ARG_SIZE,       4096,     0, "a size") \
+    X('f', ratio,   "ratio",   ARG_FLOAT,      1.5,      0, "a float") \
+    X('d', scale,   "scale",   ARG_DOUBLE,     2.5,      1, "a required double") \
+    X('V', v,       "v",       ARG_FLAG,       0,        0, "a one-letter long name") \
+    X(0,   input,   "input",   ARG_POSITIONAL, nullptr,  0, "input file") \
+    X(0,   output,  "output",  ARG_POSITIONAL, nullptr,  0, "output file")
+CLARGS_STRUCT(CheckArgs, "clargs.hpp check", CHECK_OPTS);
+
+static_assert(clargs::index_of<CheckArgs>("count") == 4, "index_of is a constant expression");
+static_assert(clargs::index_of<CheckArgs>("nope") == -1, "unknown names have no index");
+static_assert(CheckArgs::cl_count == 18, "one row per option");
+
+static long bad;
+static unsigned long long rng = 0x9E3779B97F4A7C15ull;
+
+static unsigned rnd(unsigned n) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    return (unsigned)(rng % n);
+}
+
+static Clargs *make_spec() {
+    Clargs *p = cl_create("hppcheck", "clargs.hpp check");
+    cl_add_flag(p, 'v', "verbose", "a flag");
+    cl_add_string(p, 's', "name", NULL, "a string", 0, "anon");
+    cl_add_char(p, 'c', "letter", NULL, "a char", 0, 'x');
+    cl_add_short(p, 'S', "small", NULL, "a short", 0, -3);
+    cl_add_int(p, 'i', "count", NULL, "an int", 0, 8080);
+    cl_add_long(p, 'l', "big", NULL, "a long", 0, -70000);
+    cl_add_llong(p, 'L', "huge", NULL, "a long long", 0, 1);
+    cl_add_uchar(p, 'u', "level", NULL, "an unsigned char", 0, 5);
+    cl_add_ushort(p, 'U', "port", NULL, "an unsigned short", 0, 443);
+    cl_add_uint(p, 'n', "items", NULL, "an unsigned int", 0, 7);
+    cl_add_ulong(p, 'N', "total", NULL, "an unsigned long", 0, 8);
+    cl_add_ullong(p, 'q', "seed", NULL, "an unsigned long long", 0, 9);
+    cl_add_size(p, 'z', "bytes", NULL, "a size", 0, 4096);
+    cl_add_float(p, 'f', "ratio", NULL, "a float", 0, 1.5f);
+    cl_add_double(p, 'd', "scale", NULL, "a required double", 1, 2.5);
+    cl_add_flag(p, 'V', "v", "a one-letter long name");
+    cl_add_pos(p, "input", "input file", 0);
+    cl_add_pos(p, "output", "output file", 0);
+    cl_freeze(p);
+    return p;
+}
+
+static void report(const char *what, int argc, char **argv) {
+    if (bad++ >= 20) return;
+    fprintf(stderr, "mismatch (%s):", what);
+    for (int i=0;i<argc;i++) fprintf(stderr, " %s", argv[i]);
+    fprintf(stderr, "\n");
+}
+
+// what fn writes to descriptor to (1 or 2)
+template <class F>
+static std::string capture(int to, F fn) {
+    char path[] = "/tmp/clargs-hppcheck-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return "";
+    fflush(stdout);
+    fflush(stderr);
+    int saved = dup(to);
+    dup2(fd, to);
+    fn();
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved, to);
+    close(saved);
+    std::string s;
+    char buf[4096];
+    ssize_t n;
+    lseek(fd, 0, SEEK_SET);
+    while ((n = read(fd, buf, sizeof buf)) > 0) s.append(buf, (size_t)n);
+    close(fd);
+    unlink(path);
+    return s;
+}
+
+template <class T>
+static bool same(const T &a, const T &b) { return memcmp(&a, &b, sizeof a) == 0; }
+
+static bool same_str(const char *a, const char *b) { return a == b || (a && b && !strcmp(a, b)); }
+
+// every member against the C result, by handle (the rows are in the same order)
+static bool same_values(const CheckArgs &a, const ClResult *r) {
+    bool ok = true;
+    for (int h=0;h<(int)CheckArgs::cl_count;h++) ok = ok && (a.cl_present[h] != 0) == (cl_rget_flag(r, h) != 0);
+    return ok && a.verbose == cl_rget_flag(r, 0) && same_str(a.name, cl_rget_string(r, 1))
+        && a.letter == cl_rget_char(r, 2, NULL) && a.small == cl_rget_short(r, 3, NULL)
+        && a.count == cl_rget_int(r, 4, NULL) && a.big == cl_rget_long(r, 5, NULL)
+        && a.huge == cl_rget_llong(r, 6, NULL) && a.level == cl_rget_uchar(r, 7, NULL)
+        && a.port == cl_rget_ushort(r, 8, NULL) && a.items == cl_rget_uint(r, 9, NULL)
+        && a.total == cl_rget_ulong(r, 10, NULL) && a.seed == cl_rget_ullong(r, 11, NULL)
+        && a.bytes == cl_rget_size(r, 12, NULL) && same(a.ratio, cl_rget_float(r, 13, NULL))
+        && same(a.scale, cl_rget_double(r, 14, NULL)) && a.v == cl_rget_flag(r, 15)
+        && same_str(a.input, cl_rget_string(r, 16)) && same_str(a.output, cl_rget_string(r, 17));
+}
+
+static void check(Clargs *p, ClResult *r, int argc, char **argv) {
+    CheckArgs a;
+    clargs::Error e;
+    int rc = clargs::parse_r(a, argc, argv, &e);
+    int crc = cl_parse_r(p, r, argc, argv);
+    if (rc != crc || e.err != r->err) { report("status", argc, argv); return; }
+    if (rc < 0 && (e.tok != r->err_tok || e.off != r->err_off || e.arg != r->err_arg)) { report("error detail", argc, argv); return; }
+    if (rc == CL_OK && !same_values(a, r)) report("values", argc, argv);
+    if (rc < 0 && capture(2, [&] { clargs::perror<CheckArgs>(e, argv); }) != capture(2, [&] { cl_perror(p, r, argv); }))
+        report("error message", argc, argv);
+}
+
+// a token for option o of the table, with a value that is usually valid
+static void add_option(char **argv, int *k, std::string *store, int o) {
+    static const char *const good[] = {
+        "", "word", "q", "-123", "123456", "-1234567", "-9223372036854775808", "200", "65535", "4000000000", "18446744073709551615",
+        "18446744073709551615", "64Ki", "0.25", "-1e-3", ""
+    };
+    static const char *const worse[] = { "", "", "", "40000", "99999999999", "x", "9223372036854775808", "256", "-1", "1.5", "", "-5", "12Q", "nan?", "e", "" };
+    const clargs::Option *opts = CheckArgs::cl_opts;
+    const char *val = rnd(12) ? good[opts[o].kind] : worse[opts[o].kind];
+    int kind = opts[o].kind;
+    std::string &s = store[*k];
+    switch (rnd(4)) {
+        case 0:     // --name value
+            s = std::string("--") + opts[o].long_name;
+            argv[(*k)++] = (char*)s.c_str();
+            if (kind != ARG_FLAG && rnd(20)) { store[*k] = val; argv[*k] = (char*)store[*k].c_str(); (*k)++; }
+            break;
+        case 1:     // --name=value
+            s = std::string("--") + opts[o].long_name + (kind != ARG_FLAG ? std::string("=") + val : "");
+            argv[(*k)++] = (char*)s.c_str();
+            break;
+        default:    // -x value, -xvalue, or a cluster of flags
+            s = std::string("-") + opts[o].short_name;
+            if (kind == ARG_FLAG) { if (rnd(2)) s += rnd(2) ? "v" : "V"; argv[(*k)++] = (char*)s.c_str(); break; }
+            if (rnd(2) && val[0]) { s += val; argv[(*k)++] = (char*)s.c_str(); break; }
+            argv[(*k)++] = (char*)s.c_str();
+            if (rnd(20)) { store[*k] = val; argv[*k] = (char*)store[*k].c_str(); (*k)++; }
+            break;
+    }
+}
+
+int main() {
+    Clargs *p = make_spec();
+    ClResult *r = cl_result_new(p);
+    enum { LINES = 20000, MAXTOK = 40 };
+
+    // the lookup, including the one-letter long name "v" against short -v
+    for (int i=0;i<(int)CheckArgs::cl_count;i++) {
+        const char *ln = CheckArgs::cl_opts[i].long_name;
+        if (CheckArgs::cl_opts[i].kind != ARG_POSITIONAL && clargs::lookup<CheckArgs>(ln, strlen(ln)) != cl_lookup(p, ln, strlen(ln))) {
+            bad++;
+            fprintf(stderr, "mismatch (lookup): %s\n", ln);
+        }
+    }
+    for (int c=1;c<256;c++) {
+        char ch = (char)c;
+        if (clargs::lookup<CheckArgs>(&ch, 1) != cl_lookup(p, &ch, 1)) { bad++; fprintf(stderr, "mismatch (lookup): %d\n", c); }
+    }
+
+    std::string c_help = capture(1, [&] { cl_help(p); }), cpp_help = capture(1, [] { clargs::help<CheckArgs>("hppcheck"); });
+    if (c_help != cpp_help) { bad++; fprintf(stderr, "mismatch (help)\n--- C\n%s--- C++\n%s", c_help.c_str(), cpp_help.c_str()); }
+
+    static const char *const fixed[][6] = {
+        { "hppcheck", NULL },
+        { "hppcheck", "-d", "1", NULL },
+        { "hppcheck", "--help", NULL },
+        { "hppcheck", "-d", "1", "-h", NULL },
+        { "hppcheck", "--nope", NULL },
+        { "hppcheck", "-d", "1", "-vx", NULL },
+        { "hppcheck", "-d", NULL },
+        { "hppcheck", "--scale=bad", NULL },
+        { "hppcheck", "-d1", "in", "out", "extra", NULL },
+        { "hppcheck", "--v", "-d", "1", NULL },
+    };
+    for (size_t i=0;i<sizeof fixed / sizeof fixed[0];i++) {
+        int argc = 0;
+        while (fixed[i][argc]) argc++;
+        check(p, r, argc, (char**)fixed[i]);
+    }
+
+    std::string store[MAXTOK + 8];
+    char *argv[MAXTOK + 8];
+    for (int line=0;line<LINES;line++) {
+        int k = 0, want = 1 + (int)rnd(MAXTOK / 2);
+        argv[k++] = (char*)"hppcheck";
+        while (k < want) {
+            int o = (int)rnd(CheckArgs::cl_count);
+            if (CheckArgs::cl_opts[o].kind == ARG_POSITIONAL) {
+                store[k] = rnd(30) ? (rnd(2) ? "in.txt" : "out.txt") : "-";
+                argv[k] = (char*)store[k].c_str();
+                k++;
+            } else if (!rnd(100)) {
+                // unknown names, including prefixes and extensions of real ones
+                static const char *const unknown[] = { "--unknown", "-Z", "--coun", "--verbosex", "--na=word", "--vv" };
+                argv[k++] = (char*)unknown[rnd(6)];
+            } else add_option(argv, &k, store, o);
+        }
+        argv[k] = NULL;
+        check(p, r, k, argv);
+    }
+
+    cl_result_free(r);
+    cl_free(p);
+    printf("hppcheck: %d lines, %ld mismatches\n", LINES, bad);
+    return bad != 0;
+}
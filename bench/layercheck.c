@@ -0,0 +1,112 @@
+// checks that the config cache is a transparent stand-in for the config
+// file: cl_print_config must print the same values and sources without a
+// cache, on the run that writes it, on a cache hit, and after the file
+// changes. Exits non-zero on any difference.
+
+#include "clargs.h"
+#include <stdio.h>
+
+static char dir[] = "/tmp/clargs-layercheck-XXXXXX";
+static char conf[256], cache[256], out[256];
+static long bad;
+
+static Clargs *make_spec(void) {
+    Clargs *p = cl_create("layercheck", "config cache check");
+    cl_add_flag(p, 'q', "quiet", "a flag the file turns off");
+    cl_add_flag(p, 'v', "verbose", "a flag the file turns on");
+    cl_add_flag(p, 0, "color", "a flag the file leaves alone");
+    cl_add_int(p, 'p', "p", NULL, "an int", 0, 1);
+    cl_add_int(p, 0, "port", NULL, "an int from argv", 0, 80);
+    cl_add_string(p, 'n', "name", NULL, "a string", 0, "default");
+    cl_add_string(p, 0, "path", NULL, "a string with no default", 0, NULL);
+    cl_add_double(p, 0, "ratio", NULL, "a double", 0, 0.5);
+    cl_add_size(p, 0, "max-size", NULL, "a size", 0, 1);
+    cl_add_list(p, 0, "ids", NULL, "an int list", 0, ARG_INT);
+    cl_add_list(p, 0, "tags", NULL, "a string list", 0, ARG_STRING);
+    return p;
+}
+
+static void write_file(const char *path, const char *text) {
+    FILE *f = fopen(path, "w");
+    if (!f) { perror(path); exit(2); }
+    fputs(text, f);
+    fclose(f);
+}
+
+// cl_print_config of one parse with the config (and a cache if asked),
+// captured from stdout into a malloc'd string
+static char *run(int use_cache, int argc, char **argv) {
+    Clargs *p = make_spec();
+    cl_sources(p, NULL, conf, use_cache ? cache : NULL);
+    cl_freeze(p);
+    ClResult *r = cl_result_new(p);
+    int rc = cl_parse_layers(p, r, argc, argv);
+    fflush(stdout);
+    int saved = dup(1), fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    dup2(fd, 1);
+    close(fd);
+    printf("status %s, quiet from %s\n", cl_status_name(rc), cl_source_name(cl_source(r, 0)));
+    fflush(stdout);
+    cl_print_config(p, r);
+    dup2(saved, 1);
+    close(saved);
+    cl_result_free(r);
+    cl_free(p);
+    FILE *f = fopen(out, "r");
+    char *s = (char*)calloc(1, 1 << 16);
+    if (f) { fread(s, 1, (1 << 16) - 1, f); fclose(f); }
+    return s;
+}
+
+static void expect_same(const char *what, const char *ref, const char *got) {
+    if (!strcmp(ref, got)) return;
+    bad++;
+    fprintf(stderr, "mismatch (%s)\n--- without cache\n%s--- with cache\n%s", what, ref, got);
+}
+
+static void check(const char *text, int argc, char **argv) {
+    write_file(conf, text);
+    unlink(cache);
+    char *ref = run(0, argc, argv);
+    char *build = run(1, argc, argv);
+    if (access(cache, F_OK) != 0) { bad++; fprintf(stderr, "cache was not written\n"); }
+    char *hit = run(1, argc, argv);
+    expect_same("run writing the cache", ref, build);
+    expect_same("cache hit", ref, hit);
+    free(ref);
+    free(build);
+    free(hit);
+}
+
+int main(void) {
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 2; }
+    snprintf(conf, sizeof conf, "%s/app.conf", dir);
+    snprintf(cache, sizeof cache, "%s/app.cache", dir);
+    snprintf(out, sizeof out, "%s/out", dir);
+    char *plain[] = { (char*)"layercheck", NULL };
+    char *args[] = { (char*)"layercheck", (char*)"--port", (char*)"9", (char*)"-q", (char*)"--tags", (char*)"x", NULL };
+
+    check("quiet = false\np = 7\n", 1, plain);
+    check("quiet = false\nverbose = true\np = 7\nname = from file\nratio = 2.5\nmax-size = 4Ki\nids = 1,2,3\ntags = a,b\n", 1, plain);
+    check("quiet = false\nverbose = true\np = 7\nport = 8080\nids = 1,2,3\ntags = a,b\n", 6, args);
+    check("# only comments\n\n", 1, plain);
+
+    // a stale cache must give way to the file's new contents
+    char *ref, *got;
+    write_file(conf, "quiet = false\np = 7\n");
+    unlink(cache);
+    free(run(1, 1, plain));
+    write_file(conf, "quiet = true\np = 12345\nname = changed\n");
+    ref = run(0, 1, plain);
+    got = run(1, 1, plain);
+    expect_same("stale cache", ref, got);
+    free(ref);
+    free(got);
+
+    unlink(conf);
+    unlink(cache);
+    unlink(out);
+    rmdir(dir);
+    printf("layercheck: %ld mismatches\n", bad);
+    return bad != 0;
+}
@@ -0,0 +1,84 @@
+// checks the numeric converters against libc: every value must give the
+// same bits as strtod/strtof and the same integer as strtoll/strtoull, and
+// must be rejected where libc reports ERANGE. Exits non-zero on mismatch.
+
+#include "clargs.h"
+#include <stdio.h>
+
+static unsigned long long rng = 88172645463325252ull;
+
+static unsigned long long rnd(void) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    return rng;
+}
+
+static long bad;
+
+static void report(const char *what, const char *s) {
+    if (bad++ < 20) fprintf(stderr, "mismatch (%s): \"%s\"\n", what, s);
+}
+
+static void check_float(const char *s) {
+    char *e;
+    double d = 0, ref;
+    float f = 0, fref;
+    errno = 0;
+    ref = strtod(s, &e);
+    int ok = cl_convert_float(&d, 0, s);
+    if (errno == ERANGE || *e || e == s ? ok : (!ok || memcmp(&d, &ref, sizeof d))) report("double", s);
+    errno = 0;
+    fref = strtof(s, &e);
+    ok = cl_convert_float(&f, 1, s);
+    if (errno == ERANGE || *e || e == s ? ok : (!ok || memcmp(&f, &fref, sizeof f))) report("float", s);
+}
+
+static void check_int(const char *s) {
+    char *e;
+    long long v = 0;
+    unsigned long long u = 0;
+    errno = 0;
+    long long ref = strtoll(s, &e, 10);
+    int ok = cl_convert_int(&v, ARG_LLONG, s);
+    if (errno == ERANGE || *e || e == s ? ok : (!ok || v != ref)) report("llong", s);
+    errno = 0;
+    unsigned long long uref = strtoull(s, &e, 10);
+    ok = cl_convert_int(&u, ARG_ULLONG, s);
+    // strtoull wraps negative input; the converter rejects it
+    if (s[0] == '-') { if (ok && uref != 0) report("ullong sign", s); }
+    else if (errno == ERANGE || *e || e == s ? ok : (!ok || u != uref)) report("ullong", s);
+}
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 2000000;
+    char buf[64];
+    for (long i=0;i<n;i++) {
+        double x;
+        unsigned long long b = rnd();
+        switch (i % 6) {
+            case 0: memcpy(&x, &b, sizeof x); if (x != x) continue; snprintf(buf, sizeof buf, "%.17g", x); break;
+            case 1: snprintf(buf, sizeof buf, "%llu.%llu", b % 100000000, rnd() % 1000000); break;
+            case 2: snprintf(buf, sizeof buf, "%llde%d", (long long)(b % 10000000000000000ull), (int)(rnd() % 80) - 40); break;
+            case 3: snprintf(buf, sizeof buf, "%.*g", (int)(b % 9) + 1, (double)(rnd() % 1000000) / (double)(rnd() % 1000 + 1)); break;
+            case 4: snprintf(buf, sizeof buf, "%.9g", (double)(float)((double)(b % 100000000) * 1e-4)); break;
+            default: snprintf(buf, sizeof buf, "%.*e", (int)(b % 25), (double)(rnd() % 1000000007) * 1e-300); break;
+        }
+        check_float(buf);
+        switch (i % 4) {
+            case 0: snprintf(buf, sizeof buf, "%lld", (long long)b); break;
+            case 1: snprintf(buf, sizeof buf, "%llu", b); break;
+            case 2: snprintf(buf, sizeof buf, "%llu%u", b, (unsigned)(rnd() % 100)); break;
+            default: snprintf(buf, sizeof buf, "-%llu", b >> (rnd() % 64)); break;
+        }
+        check_int(buf);
+    }
+    static const char *const edge[] = {
+        "0", "-0", "+0", "1e", "1e+", ".", ".5", "5.", "-.5e-3", "inf", "-infinity", "1e308", "1e309",
+        "2.2250738585072014e-308", "4.9406564584124654e-324", "1e-400", "9007199254740993",
+        "3.4028235e38", "3.4028236e38", "1.17549435e-38", "0.1", "123456789012345678901234567890",
+        "9223372036854775807", "9223372036854775808", "-9223372036854775808", "-9223372036854775809",
+        "18446744073709551615", "18446744073709551616", " 7", NULL
+    };
+    for (int i=0; edge[i]; i++) { check_float(edge[i]); check_int(edge[i]); }
+    printf("numcheck: %ld values, %ld mismatches\n", n, bad);
+    return bad != 0;
+}
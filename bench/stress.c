@@ -0,0 +1,180 @@
+// multi-threaded stress test for cl_parse_r: one frozen spec shared by N
+// threads, each parsing the same generated command lines into its own
+// result, in every allocation mode and with CL_LAZY. Every parse must give
+// the status and values the single-threaded reference gave. Exits non-zero
+// on mismatch. Build with -fsanitize=thread (make tsan) to check for races.
+//
+//   ./stress [threads] [lines] [rounds]
+
+#include "clargs.h"
+#include <stdio.h>
+#include <pthread.h>
+#ifdef CL_HAVE_UNISTD
+#include <unistd.h>
+#endif
+
+enum { OPTS = 64 };
+
+static unsigned long long rng = 0x2545F4914F6CDD1Dull;
+
+static unsigned rnd(unsigned n) {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    return (unsigned)(rng % n);
+}
+
+static char names[OPTS][16];
+static char positional[] = "positional";
+static int nlines, nrounds;
+static int *argcs;
+static char ***argvs;
+
+// every kind once per eight options, plus an int list and a string list
+static Clargs *make_spec(int flags) {
+    Clargs *p = cl_create_ex("stress", "stress spec", flags);
+    for (int i=0;i<OPTS;i++) {
+        switch (i % 8) {
+            case 0: cl_add_int(p, 0, names[i], NULL, "int", 0, 1); break;
+            case 1: cl_add_string(p, 0, names[i], NULL, "string", 0, "default"); break;
+            case 2: cl_add_flag(p, 0, names[i], "flag"); break;
+            case 3: cl_add_double(p, 0, names[i], NULL, "double", 0, 0.5); break;
+            case 4: cl_add_size(p, 0, names[i], NULL, "size", 0, 7); break;
+            case 5: cl_add_char(p, 0, names[i], NULL, "char", 0, 'x'); break;
+            case 6: cl_add_list(p, 0, names[i], NULL, "int list", 0, ARG_INT); break;
+            default: cl_add_list(p, 0, names[i], NULL, "string list", 0, ARG_STRING); break;
+        }
+    }
+    cl_add_pos(p, "first", "positional", 0);
+    cl_freeze(p);
+    return p;
+}
+
+// a command line of random options; about one in sixteen values is bad
+static char **make_argv(int *out_argc) {
+    int want = 2 + (int)rnd(24), k = 0;
+    char **argv = (char**)malloc((want + 4) * sizeof(char*));
+    argv[k++] = (char*)"stress";
+    while (k < want) {
+        int i = (int)rnd(OPTS);
+        char *tok = (char*)malloc(48);
+        snprintf(tok, 48, "--%s", names[i]);
+        argv[k++] = tok;
+        if (i % 8 == 2) continue;
+        char *val = (char*)malloc(48);
+        if (!rnd(16)) snprintf(val, 48, "bad%u", rnd(10));
+        else switch (i % 8) {
+            case 0: snprintf(val, 48, "%d", (int)rnd(2000000) - 1000000); break;
+            case 3: snprintf(val, 48, "%u.%ue%d", rnd(1000), rnd(1000), (int)rnd(20) - 10); break;
+            case 4: snprintf(val, 48, "%u%s", rnd(1000), rnd(2) ? "Ki" : ""); break;
+            case 5: snprintf(val, 48, "%c", 'a' + rnd(26)); break;
+            case 6: snprintf(val, 48, "%u,%u..%u", rnd(100), rnd(10), 10 + rnd(10)); break;
+            default: snprintf(val, 48, "word%u,w%u", rnd(1000), rnd(1000)); break;
+        }
+        argv[k++] = val;
+    }
+    if (rnd(2)) argv[k++] = positional;
+    argv[k] = NULL;
+    *out_argc = k;
+    return argv;
+}
+
+static uint64_t mix(uint64_t h, const void *data, size_t n) {
+    const unsigned char *b = (const unsigned char*)data;
+    for (size_t i=0;i<n;i++) h = (h ^ b[i]) * 1099511628211ull;
+    return h;
+}
+
+// status, error detail and every value of a parse, reduced to one word
+static uint64_t digest(const Clargs *p, const ClResult *r, int rc) {
+    uint64_t h = mix(1469598103934665603ull, &rc, sizeof rc);
+    if (rc != CL_OK) return mix(mix(h, &r->err_tok, sizeof r->err_tok), &r->err_arg, sizeof r->err_arg);
+    for (int k=0;k<p->count;k++) {
+        const Clarg *a = &p->args[k];
+        int given = cl_rget_flag(r, k), n;
+        h = mix(h, &given, sizeof given);
+        if (a->multi) {
+            const void *list = cl_rget_list(r, k, &n);
+            h = mix(h, &n, sizeof n);
+            for (int i=0;i<n;i++) {
+                if (a->kind == ARG_STRING) { const char *s = ((const char *const*)list)[i]; h = mix(h, s, strlen(s) + 1); }
+                else h = mix(h, (const char*)list + i * cl_kind_size[a->kind], cl_kind_size[a->kind]);
+            }
+        } else if (cl_is_str(a)) {
+            const char *s = cl_rget_string(r, k);
+            h = s ? mix(h, s, strlen(s) + 1) : mix(h, "", 0);
+        } else if (a->kind != ARG_FLAG) {
+            cl_ready(r, k);             // settles a CL_LAZY value
+            h = mix(h, &r->vals[k], cl_kind_size[a->kind]);
+        }
+    }
+    return h;
+}
+
+typedef struct {
+    const Clargs *p;
+    const uint64_t *ref;
+    int first;              // staggered so threads hit different lines at once
+    long bad;
+} Job;
+
+static void *worker(void *arg) {
+    Job *j = (Job*)arg;
+    ClResult *r = cl_result_new(j->p);
+    for (int round=0;round<nrounds;round++)
+        for (int n=0;n<nlines;n++) {
+            int i = (j->first + n) % nlines;
+            int rc = cl_parse_r(j->p, r, argcs[i], argvs[i]);
+            if (digest(j->p, r, rc) != j->ref[i]) j->bad++;
+        }
+    cl_result_free(r);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+#ifdef _SC_NPROCESSORS_ONLN
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN) * 2;
+#endif
+    if (threads < 2) threads = 4;
+    nlines = argc > 2 ? atoi(argv[2]) : 2000;
+    nrounds = argc > 3 ? atoi(argv[3]) : 5;
+    for (int i=0;i<OPTS;i++) snprintf(names[i], sizeof names[i], "opt%d", i);
+    argcs = (int*)malloc(nlines * sizeof(int));
+    argvs = (char***)malloc(nlines * sizeof(char**));
+    for (int i=0;i<nlines;i++) argvs[i] = make_argv(&argcs[i]);
+
+    static const int modes[] = { 0, CL_ARENA, CL_BORROW, CL_LAZY, CL_ARENA | CL_LAZY };
+    static const char *const mode_name[] = { "heap", "arena", "borrow", "lazy", "arena+lazy" };
+    uint64_t *ref = (uint64_t*)malloc(nlines * sizeof(uint64_t));
+    Job *jobs = (Job*)calloc(threads, sizeof(Job));
+    pthread_t *tids = (pthread_t*)calloc(threads, sizeof(pthread_t));
+    long total = 0;
+    for (int m=0;m<5;m++) {
+        Clargs *p = make_spec(modes[m]);
+        ClResult *r = cl_result_new(p);
+        for (int i=0;i<nlines;i++) ref[i] = digest(p, r, cl_parse_r(p, r, argcs[i], argvs[i]));
+        cl_result_free(r);
+        for (int t=0;t<threads;t++) {
+            jobs[t].p = p;
+            jobs[t].ref = ref;
+            jobs[t].first = (int)((long)t * nlines / threads);
+            jobs[t].bad = 0;
+            if (pthread_create(&tids[t], NULL, worker, &jobs[t]) != 0) { fprintf(stderr, "pthread_create failed\n"); return 2; }
+        }
+        long bad = 0;
+        for (int t=0;t<threads;t++) { pthread_join(tids[t], NULL); bad += jobs[t].bad; }
+        if (bad) fprintf(stderr, "mismatch (%s): %ld parses\n", mode_name[m], bad);
+        total += bad;
+        cl_free(p);
+    }
+    printf("stress: %d threads, %d lines x %d rounds x 5 modes, %ld mismatches\n", threads, nlines, nrounds, total);
+    for (int i=0;i<nlines;i++) {
+        for (int k=1;k<argcs[i];k++) if (argvs[i][k] != positional) free(argvs[i][k]);
+        free(argvs[i]);
+    }
+    free(argcs);
+    free(argvs);
+    free(ref);
+    free(jobs);
+    free(tids);
+    return total != 0;
+}
@@ -9,7 +9,31 @@
 #include <string.h>
 #include <limits.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <locale.h>
+#include <stdarg.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define CL_HAVE_MMAP 1
+#define CL_HAVE_UNISTD 1
+#endif
+#if defined(__linux__) && defined(CL_HAVE_UNISTD)
+#include <sys/syscall.h>
+#endif
+// mkstemp is POSIX.1-2008; strict ISO modes leave it undeclared
+#if defined(CL_HAVE_UNISTD) && (!defined(__STRICT_ANSI__) || (defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L) || (defined(_XOPEN_SOURCE) && _XOPEN_SOURCE >= 500) || defined(_DEFAULT_SOURCE) || defined(_GNU_SOURCE))
+#define CL_HAVE_MKSTEMP 1
+#endif
+#ifdef CLARGS_STATS
+#include <time.h>
+#endif
 
 typedef enum {
     ARG_FLAG,
@@ -30,461 +54,3536 @@ typedef enum {
     ARG_POSITIONAL
 } ArgKind;
 
+// cl_parse_r status codes; cl_parse maps every error to -1
+typedef enum {
+    CL_OK = 0,
+    CL_HELP = 1,                // -h or --help was given
+    CL_COMPLETE = 2,            // argv[1] is the hidden --__complete query
+    CL_ERR_UNKNOWN = -1,        // unknown option
+    CL_ERR_MISSING_VALUE = -2,  // option at the end of argv without its value
+    CL_ERR_BAD_VALUE = -3,      // value failed conversion or range check
+    CL_ERR_UNEXPECTED = -4,     // more positionals than declared
+    CL_ERR_REQUIRED = -5,       // required argument not given
+    CL_ERR_NOMEM = -6,
+    CL_ERR_SPEC = -7,           // spec not frozen, or result built for another spec
+    CL_ERR_RESPONSE = -8,       // @file unreadable or nested too deeply
+    CL_ERR_AMBIGUOUS = -9,      // abbreviation matches several long options
+    CL_ERR_COMMAND = -10,       // word in subcommand position names no subcommand
+    CL_ERR_CONSTRAINT = -11,    // a requires / conflicts / one-of rule is broken
+    CL_ERR_SNAPSHOT = -12,      // snapshot truncated or malformed
+    CL_ERR_CONFIG = -13         // config file unreadable, or a line in it malformed
+} ClStatus;
+
+// where a value came from, highest precedence first (see cl_sources)
+typedef enum {
+    CL_SRC_ARGV,
+    CL_SRC_ENV,
+    CL_SRC_CONFIG,
+    CL_SRC_DEFAULT
+} ClSource;
+
+// one slot wide enough for any kind; every member starts at offset 0
+typedef union {
+    const char *str;
+    char c;
+    short s;
+    int i;
+    long l;
+    long long ll;
+    unsigned char uc;
+    unsigned short us;
+    unsigned int ui;
+    unsigned long ul;
+    unsigned long long ull;
+    size_t sz;
+    float f;
+    double d;
+} ClValue;
+
+// fields touched by lookup, parsing and the getters
 typedef struct {
-    char short_name;
     const char *long_name;
+    void *bind;
+    ClValue def;
+    unsigned char kind;     // ArgKind
+    char short_name;
+    unsigned char required;
+    unsigned char multi;    // collects every value into a ClList
+} Clarg;
+
+// fields only the help printer reads
+typedef struct {
     const char *meta;
     const char *help;
-    ArgKind kind;
-    int required;
-    int present;
-    char *val_str;
-    char val_char;
-    short val_short;
-    int val_int;
-    long val_long;
-    long long val_llong;
-    unsigned char val_uchar;
-    unsigned short val_ushort;
-    unsigned int val_uint;
-    unsigned long val_ulong;
-    unsigned long long val_ullong;
-    size_t val_size;
-    float val_float;
-    double val_double;
-    const char *def_str;
-    char def_char;
-    short def_short;
-    int def_int;
-    long def_long;
-    long long def_llong;
-    unsigned char def_uchar;
-    unsigned short def_ushort;
-    unsigned int def_uint;
-    unsigned long def_ulong;
-    unsigned long long def_ullong;
-    size_t def_size;
-    float def_float;
-    double def_double;
-} Clarg;
+} ClargInfo;
+
+typedef struct {
+    unsigned hash;
+    int idx;
+} ClSlot;
+
+// radix tree node over the long option names; labels point into the names
+typedef struct {
+    const char *label;
+    int len;
+    int child;              // first child, or -1
+    int next;               // next sibling, or -1
+    int idx;                // handle whose name ends here, or -1
+    int below;              // handle of the only name in this subtree, or -1
+} ClNode;
+
+// bump allocator; heap blocks are chained through their first word and
+// released together by cl_arena_free
+typedef struct {
+    char *cur;
+    size_t left;
+    void *blocks;
+    size_t total;
+    char *buf;              // caller-owned first block, if any
+    size_t bufsize;
+} ClArena;
+
+// growable array holding every value of a list argument, each
+// cl_kind_size[kind] bytes wide
+typedef struct {
+    void *data;
+    int n;
+    int cap;
+} ClList;
+
+// growable text buffer; err is set once an allocation has failed
+typedef struct {
+    char *s;
+    size_t n;
+    size_t cap;
+    int err;
+} ClBuf;
+
+// a response file held open by a result
+typedef struct {
+    char *addr;
+    size_t len;
+} ClMap;
+
+// where a CL_LAZY parse found the value of an option, converted on first read
+typedef struct {
+    const char *val;
+    int tok;                // argv index and short-option offset, for cl_perror
+    int off;
+} ClRaw;
+
+#ifdef CLARGS_STATS
+// what cl_parse_r did for one command line (CLARGS_STATS builds only);
+// reset when a parse starts, so lazy conversions made afterwards add to it
+enum { CL_PHASE_TOKENIZE, CL_PHASE_LOOKUP, CL_PHASE_CONVERT, CL_PHASE_VALIDATE, CL_PHASES };
+
+typedef struct {
+    long tokens;            // argv words examined, @file words included
+    long lookups;           // option name lookups
+    long probes;            // hash slots those lookups visited
+    int max_probe;          // most slots one lookup visited
+    long allocs;            // heap allocations made for the result
+    long alloc_bytes;
+    long conversions[ARG_POSITIONAL + 1];   // values converted, by ArgKind
+    long long ns[CL_PHASES];                // time spent in each phase
+} ClStats;
+#endif
+
+// cl_create_ex flags
+#define CL_ARENA    1   // string copies come from one arena released in a single free
+#define CL_BORROW   2   // string values point into argv and defaults; nothing is copied
+#define CL_RESPONSE 4   // @file arguments are replaced by the words in file
+#define CL_LAZY     8   // values are converted by the first getter that reads them
+#define CL_ABBREV   16  // a long option may be given by any unambiguous prefix
+
+// constraint kinds, see cl_rule
+enum {
+    CL_RULE_REQUIRES,       // if trigger is given, every option in the group is too
+    CL_RULE_CONFLICTS,      // at most one option of the group is given
+    CL_RULE_ONE_OF,         // exactly one option of the group is given
+    CL_RULE_ANY_OF          // at least one option of the group is given
+};
+
+// the handles of a rule that fall in one word of the presence bitset
+typedef struct {
+    int word;
+    uint64_t bits;
+} ClMask;
+
+// a constraint, compiled to masks over the presence bitset
+typedef struct {
+    int kind;               // CL_RULE_*
+    int trigger;            // CL_RULE_REQUIRES: the option that needs the group
+    int first;              // its masks are masks[first .. first + n), by word
+    int n;
+} ClRule;
+
+struct Clargs;
+
+// fills in the spec of a subcommand: cl_add_* calls on sub, which is
+// created empty with the parent's flags
+typedef void (*ClBuildFn)(struct Clargs *sub, void *ud);
+
+// a subcommand; its spec is built by build the first time it is needed
+typedef struct {
+    const char *name;
+    const char *help;
+    ClBuildFn build;
+    void *ud;
+    struct Clargs *spec;
+    char *prog;             // "parent-prog name", the spec's program name
+} ClCmd;
+
+// cl_set_width: wrap help text to the terminal's width
+#define CL_WIDTH_TERMINAL (-1)
+
+// how deeply @files may include other @files
+#ifndef CL_RESPONSE_DEPTH
+#define CL_RESPONSE_DEPTH 16
+#endif
 
+// the mutable half of a parse: values, presence and error detail for one
+// command line, so a frozen spec can be shared by many results
 typedef struct {
+    const struct Clargs *spec;
+    ClValue *vals;          // indexed by handle
+    uint64_t *present;      // bit per handle: given on the command line or by a layer
+    uint64_t *pending;      // bit per handle: CL_LAZY value not yet converted
+    int count;
+    int npos;               // positionals filled so far
+    ClList *lists;          // indexed by handle, allocated on first use
+    int nlists;
+    ClArena arena;
+    char **xargv;           // argv with @files expanded, if the last parse had any
+    int nx;
+    int xcap;
+    ClMap *maps;            // response files mapped by the last parse
+    int nmaps;
+    int mapcap;
+    char *tail;             // cl_parse_lines' copy of an unterminated last line
+    ClRaw *raw;             // CL_LAZY: indexed by handle, allocated on first use
+    int nraw;
+    int cmd;                // subcommand chosen by the last parse, or -1
+    int cmd_tok;            // its argv index; its own arguments follow it
+    int err;                // ClStatus of the last parse
+    int err_tok;            // argv index of the offending option or token
+    int err_off;            // offset of the short option within it, 0 for long options
+    int err_arg;            // handle involved, or -1
+    int err_rule;           // rule broken, for CL_ERR_CONSTRAINT, or -1
+    int err_src;            // ClSource of the error; for CL_SRC_CONFIG err_tok is the line
+    const char *err_text;   // config key at fault, for CL_SRC_CONFIG errors
+    uint64_t *layer;        // two rows of nlayer words: bit per handle set from the
+    int nlayer;             // environment, then from the config file
+#ifdef CLARGS_STATS
+    ClStats stats;
+#endif
+} ClResult;
+
+#ifdef CLARGS_STATS
+// called at the end of every cl_parse_r with the result, its stats and the
+// argv that was parsed, whatever the outcome
+typedef void (*ClStatsFn)(const ClResult *r, char **argv, void *ud);
+#endif
+
+typedef struct Clargs {
     const char *prog;
     const char *desc;
-    Clarg **args;
+    int flags;
+    Clarg *args;            // contiguous, indexed by handle
+    ClargInfo *info;        // parallel to args
     int cap;
     int count;
+    // lookup index, rebuilt lazily after the last cl_add_* call
+    int short_idx[256];
+    ClSlot *slots;
+    int nslots;
+    int *pos;               // positional handles in declaration order
+    int npos;
+    uint64_t *required;     // bit per handle a parse must see given
+    uint64_t fingerprint;   // see cl_spec_hash
+    ClRule *rules;          // constraints, checked in order after a parse
+    int nrules;
+    int rulecap;
+    ClMask *masks;          // shared by the rules
+    int nmasks;
+    int maskcap;
+    ClNode *trie;           // option long names, node 0 is the root
+    int ntrie;
+    int longest;            // longest long name
+    ClCmd *cmds;            // subcommands, in registration order
+    int ncmds;
+    int cmdcap;
+    int width;              // help wrap column, 0 for none
+    ClBuf help;             // rendered help text, kept for the next cl_help
+    const char *help_prog;  // what the cached text was rendered for
+    int help_count;
+    int help_width;
+    int indexed;
+    const char *env_prefix; // layered sources, see cl_sources
+    const char *config;
+    const char *config_cache;
+#ifdef CLARGS_STATS
+    ClStatsFn stats_fn;     // export hook, inherited by subcommands
+    void *stats_ud;
+#endif
+    ClResult res;           // backs cl_parse and the cl_get_* getters
 } Clargs;
 
-static inline Clarg *make_arg() {
-    return (Clarg*)calloc(1, sizeof(Clarg));
+// byte width of each kind's value, as written by cl_bind_*
+static const unsigned char cl_kind_size[] = {
+    sizeof(int), sizeof(const char*), sizeof(char), sizeof(short), sizeof(int), sizeof(long), sizeof(long long),
+    sizeof(unsigned char), sizeof(unsigned short), sizeof(unsigned int), sizeof(unsigned long), sizeof(unsigned long long),
+    sizeof(size_t), sizeof(float), sizeof(double), sizeof(const char*)
+};
+
+static inline int cl_is_str(const Clarg *a) {
+    return a->kind == ARG_STRING || a->kind == ARG_POSITIONAL;
+}
+
+// bitsets 
+
+// one bit per handle, 64 to a word
+#define CL_WORDS(n) (((n) + 63) >> 6)
+
+static inline int cl_bit(const uint64_t *w, int h) {
+    return (int)(w[h >> 6] >> (h & 63)) & 1;
 }
 
-static inline void free_arg(Clarg *a) {
-    if (!a) return;
-    if (a->val_str) free(a->val_str);
-    free(a);
+static inline void cl_bit_set(uint64_t *w, int h) {
+    w[h >> 6] |= (uint64_t)1 << (h & 63);
 }
 
-static Clargs *cl_create(const char *prog, const char *desc) {
+static inline void cl_bit_clr(uint64_t *w, int h) {
+    w[h >> 6] &= ~((uint64_t)1 << (h & 63));
+}
+
+static inline int cl_popcount(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    for (; x; x &= x - 1) n++;
+    return n;
+#endif
+}
+
+// index of the lowest set bit; x is not 0
+static inline int cl_lowest(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) { x >>= 1; n++; }
+    return n;
+#endif
+}
+
+// statistics 
+
+// the counters and clocks below compile to nothing unless CLARGS_STATS is
+// defined before the header is included
+#ifdef CLARGS_STATS
+static long long cl_now_ns(void) {
+#if defined(CL_HAVE_UNISTD) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#else
+    return (long long)((double)clock() * (1e9 / CLOCKS_PER_SEC));
+#endif
+}
+#define CL_STAT(r, field, n)    ((r)->stats.field += (n))
+#define CL_STAT_ALLOC(r, n)     ((r)->stats.allocs++, (r)->stats.alloc_bytes += (long)(n))
+#define CL_CLOCK(t)             long long t = cl_now_ns()
+#define CL_LAP(r, phase, t)     ((r)->stats.ns[phase] += cl_now_ns() - (t))
+
+// installs fn to receive every parse's stats; set it before sharing the
+// spec between threads, since each parse reads it from the spec
+static void cl_stats_hook(Clargs *p, ClStatsFn fn, void *ud) {
+    if (!p) return;
+    p->stats_fn = fn;
+    p->stats_ud = ud;
+}
+
+// stats of the last cl_parse of p
+static const ClStats *cl_stats(const Clargs *p) {
+    return p ? &p->res.stats : NULL;
+}
+#else
+#define CL_STAT(r, field, n)    ((void)0)
+#define CL_STAT_ALLOC(r, n)     ((void)0)
+#define CL_CLOCK(t)             ((void)0)
+#define CL_LAP(r, phase, t)     ((void)0)
+#endif
+
+// arena 
+
+#define CL_ARENA_BLOCK 4096
+
+static void *cl_arena_alloc(ClArena *ar, size_t n) {
+    n = (n + 7) & ~(size_t)7;
+    if (n > ar->left) {
+        size_t size = n + 16 > CL_ARENA_BLOCK ? n + 16 : CL_ARENA_BLOCK;
+        char *b = (char*)malloc(size);
+        if (!b) return NULL;
+        ((void**)b)[0] = ar->blocks;
+        ((size_t*)b)[1] = size;
+        ar->blocks = b;
+        ar->cur = b + 16;
+        ar->left = size - 16;
+        ar->total += size;
+    }
+    void *r = ar->cur;
+    ar->cur += n;
+    ar->left -= n;
+    return r;
+}
+
+static void cl_arena_free(ClArena *ar) {
+    while (ar->blocks) { void *next = *(void**)ar->blocks; free(ar->blocks); ar->blocks = next; }
+    ar->cur = ar->buf;
+    ar->left = ar->bufsize;
+    ar->total = 0;
+}
+
+// rewinds the arena for reuse, keeping the newest heap block
+static void cl_arena_reset(ClArena *ar) {
+    if (ar->buf || !ar->blocks) { cl_arena_free(ar); return; }
+    char *b = (char*)ar->blocks;
+    void *rest = ((void**)b)[0];
+    while (rest) { void *next = *(void**)rest; free(rest); rest = next; }
+    ((void**)b)[0] = NULL;
+    ar->total = ((size_t*)b)[1];
+    ar->cur = b + 16;
+    ar->left = ar->total - 16;
+}
+
+// result strings 
+
+// whether s points into one of the response files r has mapped
+static inline int cl_mapped(const ClResult *r, const char *s) {
+    for (int i=0;i<r->nmaps;i++) if (s >= r->maps[i].addr && s < r->maps[i].addr + r->maps[i].len) return 1;
+    return 0;
+}
+
+// copies a string value according to the spec's allocation mode; words
+// from response files already live as long as the result and are kept
+static const char *cl_strdup(ClResult *r, const char *s) {
+    int flags = r->spec->flags;
+    if (!s || (flags & CL_BORROW) || cl_mapped(r, s)) return s;
+    size_t n = strlen(s) + 1;
+    char *d;
+    // malloc rather than strdup, which strict ISO C modes leave undeclared
+    if (!(flags & CL_ARENA)) { CL_STAT_ALLOC(r, n); d = (char*)malloc(n); }
+    else d = (char*)cl_arena_alloc(&r->arena, n);
+    if (d) memcpy(d, s, n);
+    return d;
+}
+
+// releases the value of h if the result owns it; defaults are never copied
+static inline void cl_strfree(ClResult *r, int h) {
+    const char *s = r->vals[h].str;
+    if (s && s != r->spec->args[h].def.str && !(r->spec->flags & (CL_ARENA | CL_BORROW)) && !cl_mapped(r, s)) free((void*)s);
+}
+
+// response files 
+
+static void cl_unmap(ClResult *r) {
+    for (int i=0;i<r->nmaps;i++) {
+#ifdef CL_HAVE_MMAP
+        munmap(r->maps[i].addr, r->maps[i].len);
+#else
+        free(r->maps[i].addr);
+#endif
+    }
+    r->nmaps = 0;
+}
+
+// maps path privately so it can be tokenized in place; an empty file
+// yields len 0 and no mapping
+static char *cl_map_file(ClResult *r, const char *path, size_t *len) {
+    static char empty[1];
+    if (r->nmaps == r->mapcap) {
+        int cap = r->mapcap ? r->mapcap * 2 : 4;
+        ClMap *m = (ClMap*)realloc(r->maps, cap * sizeof(ClMap));
+        CL_STAT_ALLOC(r, cap * sizeof(ClMap));
+        if (!m) return NULL;
+        r->maps = m;
+        r->mapcap = cap;
+    }
+    char *addr;
+#ifdef CL_HAVE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) { close(fd); return NULL; }
+    *len = (size_t)st.st_size;
+    if (!*len) { close(fd); return empty; }
+    addr = (char*)mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == (char*)MAP_FAILED) return NULL;
+#else
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (n <= 0) { fclose(f); *len = 0; return n < 0 ? NULL : empty; }
+    addr = (char*)malloc((size_t)n);
+    CL_STAT_ALLOC(r, n);
+    if (addr && fread(addr, 1, (size_t)n, f) != (size_t)n) { free(addr); addr = NULL; }
+    fclose(f);
+    if (!addr) return NULL;
+    *len = (size_t)n;
+#endif
+    r->maps[r->nmaps].addr = addr;
+    r->maps[r->nmaps].len = *len;
+    r->nmaps++;
+    return addr;
+}
+
+static int cl_xpush(ClResult *r, char *tok) {
+    if (r->nx == r->xcap) {
+        int cap = r->xcap ? r->xcap * 2 : 64;
+        char **x = (char**)realloc(r->xargv, cap * sizeof(char*));
+        CL_STAT_ALLOC(r, cap * sizeof(char*));
+        if (!x) return 0;
+        r->xargv = x;
+        r->xcap = cap;
+    }
+    r->xargv[r->nx++] = tok;
+    return 1;
+}
+
+static inline int cl_isspace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static int cl_expand(ClResult *r, char *tok, int depth);
+
+// splits a response file into words in place: whitespace separates words,
+// single quotes are literal, backslash escapes the next character outside
+// single quotes; each word is NUL-terminated where its separator was.
+// tok is the @file word itself and becomes the offending token on failure
+static int cl_respfile(ClResult *r, char *tok, int depth) {
+    size_t len;
+    char *s = depth > CL_RESPONSE_DEPTH ? NULL : cl_map_file(r, tok + 1, &len);
+    if (!s) return cl_xpush(r, tok) ? CL_ERR_RESPONSE : CL_ERR_NOMEM;
+    char *end = s + len;
+    for (;;) {
+        while (s < end && cl_isspace(*s)) s++;
+        if (s >= end) break;
+        char *word = s, *w = s, q = 0;
+        int lit = *s == '\'' || *s == '"' || *s == '\\';
+        while (s < end) {
+            char c = *s++;
+            if (q) {
+                if (c == q) { q = 0; continue; }
+                if (c == '\\' && q == '"' && s < end) c = *s++;
+            } else if (cl_isspace(c)) {
+                s--;
+                break;
+            } else if (c == '\'' || c == '"') {
+                q = c;
+                continue;
+            } else if (c == '\\' && s < end) {
+                c = *s++;
+            }
+            *w++ = c;
+        }
+        if (w < end) {
+            *w = 0;
+        } else {
+            // the word runs to the end of the file: no byte left for its NUL
+            size_t n = (size_t)(w - word);
+            char *d = (char*)cl_arena_alloc(&r->arena, n + 1);
+            if (!d) return CL_ERR_NOMEM;
+            memcpy(d, word, n);
+            d[n] = 0;
+            word = d;
+        }
+        if (s < end) s++;
+        int rc = lit ? (cl_xpush(r, word) ? CL_OK : CL_ERR_NOMEM) : cl_expand(r, word, depth);
+        if (rc != CL_OK) return rc;
+    }
+    return CL_OK;
+}
+
+// appends tok to the expanded argv, or the words of its file for @file
+static int cl_expand(ClResult *r, char *tok, int depth) {
+    if (tok[0] != '@' || !tok[1]) return cl_xpush(r, tok) ? CL_OK : CL_ERR_NOMEM;
+    return cl_respfile(r, tok, depth + 1);
+}
+
+// list values 
+
+// makes room for extra more values of h and returns the first free slot;
+// the caller bumps the count once the slots are filled
+static void *cl_list_reserve(ClResult *r, int h, int extra) {
+    if (r->nlists < r->count) {
+        ClList *l = (ClList*)realloc(r->lists, r->count * sizeof(ClList));
+        CL_STAT_ALLOC(r, r->count * sizeof(ClList));
+        if (!l) return NULL;
+        memset(l + r->nlists, 0, (r->count - r->nlists) * sizeof(ClList));
+        r->lists = l;
+        r->nlists = r->count;
+    }
+    ClList *l = &r->lists[h];
+    size_t w = cl_kind_size[r->spec->args[h].kind];
+    if (l->cap - l->n < extra) {
+        int cap = l->cap ? l->cap * 2 : 8;
+        while (cap - l->n < extra) cap *= 2;
+        void *d = realloc(l->data, cap * w);
+        CL_STAT_ALLOC(r, cap * w);
+        if (!d) return NULL;
+        l->data = d;
+        l->cap = cap;
+    }
+    return (char*)l->data + w * l->n;
+}
+
+static inline void *cl_list_push(ClResult *r, int h) {
+    void *slot = cl_list_reserve(r, h, 1);
+    if (slot) r->lists[h].n++;
+    return slot;
+}
+
+// list elements are never freed one by one: a whole word is kept when the
+// spec borrows or it lives in a mapped response file, and anything else
+// (including the pieces of a comma-separated word) is copied into the
+// result's arena
+static int cl_list_add_str(ClResult *r, int h, const char *val, size_t n, int whole) {
+    const char **slot = (const char**)cl_list_push(r, h);
+    if (!slot) return 0;
+    if (!whole || (!(r->spec->flags & CL_BORROW) && !cl_mapped(r, val))) {
+        char *d = (char*)cl_arena_alloc(&r->arena, n + 1);
+        if (!d) { r->lists[h].n--; return 0; }
+        memcpy(d, val, n);
+        d[n] = 0;
+        val = d;
+    }
+    *slot = val;
+    return 1;
+}
+
+// restores every value to its default and clears presence and error state
+static void cl_result_reset(ClResult *r) {
+    const Clargs *p = r->spec;
+    for (int h=0;h<r->count;h++) {
+        if (cl_is_str(&p->args[h])) cl_strfree(r, h);
+        r->vals[h] = p->args[h].def;
+    }
+    memset(r->present, 0, CL_WORDS(r->count) * sizeof(uint64_t));
+    memset(r->pending, 0, CL_WORDS(r->count) * sizeof(uint64_t));
+    for (int h=0;h<r->nlists;h++) r->lists[h].n = 0;
+    cl_unmap(r);
+    cl_arena_reset(&r->arena);
+    r->nx = 0;
+    r->npos = 0;
+    r->cmd = -1;
+    r->cmd_tok = 0;
+    r->err = CL_OK;
+    r->err_tok = 0;
+    r->err_off = 0;
+    r->err_arg = -1;
+    r->err_rule = -1;
+    r->err_src = CL_SRC_ARGV;
+    r->err_text = NULL;
+    if (r->layer) memset(r->layer, 0, 2 * r->nlayer * sizeof(uint64_t));
+}
+
+static void cl_result_release(ClResult *r) {
+    for (int h=0;h<r->count;h++) if (cl_is_str(&r->spec->args[h])) cl_strfree(r, h);
+    for (int h=0;h<r->nlists;h++) free(r->lists[h].data);
+    cl_unmap(r);
+    cl_arena_free(&r->arena);
+    free(r->lists);
+    free(r->xargv);
+    free(r->maps);
+    free(r->tail);
+    free(r->raw);
+    free(r->vals);
+    free(r->present);
+    free(r->pending);
+    free(r->layer);
+}
+
+// hands a result's arena a caller-owned buffer to fill before it touches
+// the heap; buf must outlive the result and is never freed by it
+static void cl_result_buffer(ClResult *r, void *buf, size_t size) {
+    if (!r || !buf || r->arena.left) return;
+    size_t skew = (size_t)buf & 7;
+    if (skew) { skew = 8 - skew; if (size < skew) return; buf = (char*)buf + skew; size -= skew; }
+    r->arena.buf = r->arena.cur = (char*)buf;
+    r->arena.bufsize = r->arena.left = size;
+}
+
+// parser 
+
+static Clargs *cl_create_ex(const char *prog, const char *desc, int flags) {
     Clargs *p = (Clargs*)malloc(sizeof(Clargs));
     p->prog = prog ? prog : "program";
     p->desc = desc ? desc : "";
+    p->flags = flags;
     p->cap = 8;
     p->count = 0;
-    p->args = (Clarg**)calloc(p->cap, sizeof(Clarg*));
+    p->args = (Clarg*)malloc(p->cap * sizeof(Clarg));
+    p->info = (ClargInfo*)malloc(p->cap * sizeof(ClargInfo));
+    p->slots = NULL;
+    p->nslots = 0;
+    p->pos = NULL;
+    p->npos = 0;
+    p->required = NULL;
+    p->fingerprint = 0;
+    p->rules = NULL;
+    p->nrules = 0;
+    p->rulecap = 0;
+    p->masks = NULL;
+    p->nmasks = 0;
+    p->maskcap = 0;
+    p->trie = NULL;
+    p->ntrie = 0;
+    p->longest = 0;
+    p->cmds = NULL;
+    p->ncmds = 0;
+    p->cmdcap = 0;
+    p->width = 0;
+    memset(&p->help, 0, sizeof(ClBuf));
+    p->help_prog = NULL;
+    p->help_count = -1;
+    p->help_width = 0;
+    p->indexed = 0;
+    p->env_prefix = NULL;
+    p->config = NULL;
+    p->config_cache = NULL;
+#ifdef CLARGS_STATS
+    p->stats_fn = NULL;
+    p->stats_ud = NULL;
+#endif
+    memset(&p->res, 0, sizeof(ClResult));
+    p->res.spec = p;
+    p->res.vals = (ClValue*)malloc(p->cap * sizeof(ClValue));
+    p->res.present = (uint64_t*)calloc(CL_WORDS(p->cap), sizeof(uint64_t));
+    p->res.pending = (uint64_t*)calloc(CL_WORDS(p->cap), sizeof(uint64_t));
+    p->res.cmd = -1;
+    p->res.err_arg = -1;
+    p->res.err_rule = -1;
     return p;
 }
 
+static Clargs *cl_create(const char *prog, const char *desc) {
+    return cl_create_ex(prog, desc, 0);
+}
+
+// seeds the parser's own result arena (CL_ARENA mode) with a caller buffer
+static void cl_arena_buffer(Clargs *p, void *buf, size_t size) {
+    if (p) cl_result_buffer(&p->res, buf, size);
+}
+
 static void cl_free(Clargs *p) {
     if (!p) return;
-    for (int i=0;i<p->count;i++) free_arg(p->args[i]);
+    cl_result_release(&p->res);
     free(p->args);
+    free(p->info);
+    free(p->slots);
+    free(p->pos);
+    free(p->required);
+    free(p->rules);
+    free(p->masks);
+    free(p->trie);
+    free(p->help.s);
+    for (int i=0;i<p->ncmds;i++) { cl_free(p->cmds[i].spec); free(p->cmds[i].prog); }
+    free(p->cmds);
     free(p);
 }
 
 static void cl_grow(Clargs *p) {
+    p->indexed = 0;
     if (p->count >= p->cap) {
+        int words = CL_WORDS(p->cap);
         p->cap *= 2;
-        p->args = (Clarg**)realloc(p->args, p->cap * sizeof(Clarg*));
+        p->args = (Clarg*)realloc(p->args, p->cap * sizeof(Clarg));
+        p->info = (ClargInfo*)realloc(p->info, p->cap * sizeof(ClargInfo));
+        p->res.vals = (ClValue*)realloc(p->res.vals, p->cap * sizeof(ClValue));
+        if (CL_WORDS(p->cap) > words) {
+            p->res.present = (uint64_t*)realloc(p->res.present, CL_WORDS(p->cap) * sizeof(uint64_t));
+            p->res.pending = (uint64_t*)realloc(p->res.pending, CL_WORDS(p->cap) * sizeof(uint64_t));
+            memset(p->res.present + words, 0, (CL_WORDS(p->cap) - words) * sizeof(uint64_t));
+            memset(p->res.pending + words, 0, (CL_WORDS(p->cap) - words) * sizeof(uint64_t));
+        }
     }
 }
 
-static int cl_find_idx(Clargs *p, const char *name) {
+// appends a zeroed argument; pointers into p->args stay valid only until
+// the next cl_add_* call
+static Clarg *cl_new(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, ArgKind kind, int req) {
+    cl_grow(p);
+    Clarg *a = &p->args[p->count];
+    memset(a, 0, sizeof(Clarg));
+    a->short_name = short_name;
+    a->long_name = long_name;
+    a->kind = (unsigned char)kind;
+    a->required = req ? 1 : 0;
+    p->info[p->count].meta = meta;
+    p->info[p->count].help = help;
+    cl_bit_clr(p->res.present, p->count);
+    cl_bit_clr(p->res.pending, p->count);
+    p->count++;
+    return a;
+}
+
+// publishes the default of the argument just added to the parser's own
+// result and returns its handle
+static int cl_added(Clargs *p) {
+    int h = p->count - 1;
+    p->res.vals[h] = p->args[h].def;
+    p->res.count = p->count;
+    return h;
+}
+
+// heap bytes held by the parser, including owned string values
+static size_t cl_footprint(const Clargs *p) {
+    size_t n = sizeof(Clargs) + p->cap * (sizeof(Clarg) + sizeof(ClargInfo) + sizeof(ClValue)) + 2 * CL_WORDS(p->cap) * sizeof(uint64_t)
+             + p->nslots * sizeof(ClSlot) + p->npos * sizeof(int) + p->ntrie * sizeof(ClNode)
+             + (p->indexed ? CL_WORDS(p->count) * sizeof(uint64_t) : 0) + p->rulecap * sizeof(ClRule) + p->maskcap * sizeof(ClMask) + p->help.cap + p->cmdcap * sizeof(ClCmd) + p->res.arena.total
+             + p->res.nlists * sizeof(ClList) + p->res.xcap * sizeof(char*) + p->res.mapcap * sizeof(ClMap)
+             + p->res.nraw * sizeof(ClRaw);
+    for (int h=0;h<p->res.nlists;h++) n += p->res.lists[h].cap * cl_kind_size[p->args[h].kind];
+    if (p->flags & (CL_ARENA | CL_BORROW)) return n;
+    for (int h=0;h<p->count;h++) {
+        const char *s = p->res.vals[h].str;
+        if (cl_is_str(&p->args[h]) && s && s != p->args[h].def.str) n += strlen(s) + 1;
+    }
+    return n;
+}
+
+// prefix tree 
+
+// appends a node; the tree is sized up front so this never reallocates
+static inline int cl_trie_node(Clargs *p, const char *label, int len, int idx) {
+    ClNode *t = &p->trie[p->ntrie];
+    t->label = label;
+    t->len = len;
+    t->child = -1;
+    t->next = -1;
+    t->idx = idx;
+    t->below = -1;
+    return p->ntrie++;
+}
+
+// inserts name for handle h, splitting an edge where name leaves it; a
+// name already present keeps its first handle
+static void cl_trie_add(Clargs *p, const char *name, int h) {
+    int len = (int)strlen(name), at = 0, node = 0;
+    while (at < len) {
+        int c = p->trie[node].child, last = -1;
+        while (c >= 0 && p->trie[c].label[0] != name[at]) { last = c; c = p->trie[c].next; }
+        if (c < 0) {
+            int k = cl_trie_node(p, name + at, len - at, h);
+            if (last < 0) p->trie[node].child = k; else p->trie[last].next = k;
+            return;
+        }
+        int m = 1;
+        while (m < p->trie[c].len && at + m < len && p->trie[c].label[m] == name[at + m]) m++;
+        if (m < p->trie[c].len) {
+            int k = cl_trie_node(p, p->trie[c].label + m, p->trie[c].len - m, p->trie[c].idx);
+            p->trie[k].child = p->trie[c].child;
+            p->trie[c].len = m;
+            p->trie[c].idx = -1;
+            p->trie[c].child = k;
+        }
+        at += m;
+        node = c;
+    }
+    if (p->trie[node].idx < 0) p->trie[node].idx = h;
+}
+
+// fills in below for the subtree at n; returns its only handle, or -1
+static int cl_trie_seal(ClNode *t, int n) {
+    int only = t[n].idx, many = 0;
+    for (int c=t[n].child;c>=0;c=t[c].next) {
+        int b = cl_trie_seal(t, c);
+        if (b < 0 || only >= 0) many = 1;
+        else only = b;
+    }
+    return t[n].below = many ? -1 : only;
+}
+
+// node where the path spelled by name ends, possibly inside its edge, or -1
+static int cl_trie_find(const Clargs *p, const char *name, size_t len) {
+    const ClNode *t = p->trie;
+    int node = 0;
+    size_t at = 0;
+    if (!t) return -1;
+    while (at < len) {
+        int c = t[node].child;
+        while (c >= 0 && t[c].label[0] != name[at]) c = t[c].next;
+        if (c < 0) return -1;
+        size_t m = (size_t)t[c].len < len - at ? (size_t)t[c].len : len - at;
+        if (memcmp(t[c].label, name + at, m) != 0) return -1;
+        at += m;
+        node = c;
+    }
+    return node;
+}
+
+// the option a prefix abbreviates: its handle, -1 if no long option starts
+// with it, -2 if several do
+static int cl_prefix(const Clargs *p, const char *name, size_t len) {
+    int node = len ? cl_trie_find(p, name, len) : -1;
+    if (node < 0) return -1;
+    return p->trie[node].below >= 0 ? p->trie[node].below : -2;
+}
+
+// collects up to max handles from the subtree at n, in declaration order
+// within each branch
+static int cl_trie_list(const ClNode *t, int n, int *out, int k, int max) {
+    if (k < max && t[n].idx >= 0) out[k++] = t[n].idx;
+    for (int c=t[n].child;c>=0 && k<max;c=t[c].next) k = cl_trie_list(t, c, out, k, max);
+    return k;
+}
+
+typedef struct {
+    const ClNode *t;
+    const char *q;          // the misspelled name
+    int m;
+    int *rows;              // one edit-distance row of m+1 entries per depth
+    char *path;             // the characters spelled so far
+    int max;
+    int best;
+    int bestd;
+} ClFuzzy;
+
+// walks the subtree at n extending one row per character; a branch is cut
+// as soon as no entry of its row is within the bound. Adjacent swaps count
+// as one edit
+static void cl_fuzzy(ClFuzzy *f, int n, int depth) {
+    const ClNode *nd = &f->t[n];
+    int w = f->m + 1;
+    for (int k=0;k<nd->len;k++) {
+        const int *prev = f->rows + depth * w;
+        int *row = f->rows + (depth + 1) * w;
+        char ch = nd->label[k];
+        int lo = row[0] = depth + 1;
+        for (int j=1;j<=f->m;j++) {
+            int v = prev[j-1] + (f->q[j-1] != ch);
+            if (prev[j] + 1 < v) v = prev[j] + 1;
+            if (row[j-1] + 1 < v) v = row[j-1] + 1;
+            if (depth && j > 1 && f->q[j-1] == f->path[depth-1] && f->q[j-2] == ch) {
+                int t = f->rows[(depth - 1) * w + j - 2] + 1;
+                if (t < v) v = t;
+            }
+            row[j] = v;
+            if (v < lo) lo = v;
+        }
+        f->path[depth++] = ch;
+        if (lo > f->max) return;
+    }
+    if (nd->idx >= 0) {
+        int d = f->rows[depth * w + f->m];
+        if (d <= f->max && (d < f->bestd || (d == f->bestd && nd->idx < f->best))) { f->best = nd->idx; f->bestd = d; }
+    }
+    for (int c=nd->child;c>=0;c=f->t[c].next) cl_fuzzy(f, c, depth);
+}
+
+// long option closest to a misspelled name, within one edit for short
+// names and up to three for long ones, or -1; a name that abbreviates a
+// single option suggests it as well
+static int cl_suggest(const Clargs *p, const char *name, size_t len) {
+    if (!p->trie || !len) return -1;
+    int max = len <= 4 ? 1 : len <= 8 ? 2 : 3;
+    if (len > (size_t)(p->longest + max)) return -1;
+    ClFuzzy f;
+    f.t = p->trie;
+    f.q = name;
+    f.m = (int)len;
+    f.max = max;
+    f.best = -1;
+    f.bestd = max + 1;
+    f.rows = (int*)malloc((size_t)(p->longest + 1) * (len + 1) * sizeof(int) + p->longest + 1);
+    if (!f.rows) return -1;
+    f.path = (char*)(f.rows + (size_t)(p->longest + 1) * (len + 1));
+    for (int j=0;j<=f.m;j++) f.rows[j] = j;
+    cl_fuzzy(&f, 0, 0);
+    free(f.rows);
+    if (f.best < 0) { int h = cl_prefix(p, name, len); if (h >= 0) return h; }
+    return f.best;
+}
+
+// name index 
+
+static inline unsigned cl_hash(const char *s, size_t n) {
+    unsigned h = 2166136261u;
+    for (size_t i=0;i<n;i++) { h ^= (unsigned char)s[i]; h *= 16777619u; }
+    return h;
+}
+
+// short names go into a direct table, long and positional names into an
+// open-addressing table sized to at most half full; the first registration
+// of a name wins, as it did with the linear scan. Option long names also go
+// into the prefix tree used for abbreviations and suggestions
+static void cl_index(Clargs *p) {
+    for (int i=0;i<256;i++) p->short_idx[i] = -1;
+    int n = 16;
+    while (n < p->count * 2) n *= 2;
+    if (n != p->nslots) {
+        free(p->slots);
+        p->slots = (ClSlot*)malloc(n * sizeof(ClSlot));
+        p->nslots = n;
+    }
+    for (int i=0;i<n;i++) p->slots[i].idx = -1;
+    free(p->pos);
+    p->pos = (int*)malloc((p->count ? p->count : 1) * sizeof(int));
+    p->npos = 0;
+    // a required string with a default is satisfied by the default
+    free(p->required);
+    p->required = (uint64_t*)calloc(CL_WORDS(p->count) ? CL_WORDS(p->count) : 1, sizeof(uint64_t));
+    uint64_t fp = 1469598103934665603ull ^ (uint64_t)p->count;
     for (int i=0;i<p->count;i++) {
-        Clarg *a = p->args[i];
-        if (a->long_name && name && strcmp(a->long_name, name) == 0) return i;
-        if (a->short_name && name && strlen(name)==1 && a->short_name == name[0]) return i;
-        if (a->kind == ARG_POSITIONAL && name && strcmp(a->long_name, name)==0) return i;
+        Clarg *a = &p->args[i];
+        if (a->required && a->kind != ARG_FLAG && !(a->kind == ARG_STRING && !a->multi && a->def.str)) cl_bit_set(p->required, i);
+        if (a->kind == ARG_POSITIONAL) p->pos[p->npos++] = i;
+        if (a->short_name && p->short_idx[(unsigned char)a->short_name] < 0) p->short_idx[(unsigned char)a->short_name] = i;
+        size_t len = a->long_name ? strlen(a->long_name) : 0;
+        unsigned h = a->long_name ? cl_hash(a->long_name, len) : 0;
+        fp = (fp ^ (h | (uint64_t)a->kind << 32 | (uint64_t)!!a->multi << 40 | (uint64_t)(unsigned char)a->short_name << 48)) * 1099511628211ull;
+        if (!a->long_name) continue;
+        unsigned k = h & (n - 1);
+        while (p->slots[k].idx >= 0) {
+            if (p->slots[k].hash == h && strcmp(p->args[p->slots[k].idx].long_name, a->long_name) == 0) break;
+            k = (k + 1) & (n - 1);
+        }
+        if (p->slots[k].idx < 0) { p->slots[k].hash = h; p->slots[k].idx = i; }
     }
-    return -1;
+    p->fingerprint = fp;
+    // an insert adds at most a leaf and a split node
+    free(p->trie);
+    p->trie = (ClNode*)malloc((2 * p->count + 1) * sizeof(ClNode));
+    p->ntrie = 0;
+    p->longest = 0;
+    if (p->trie) {
+        cl_trie_node(p, "", 0, -1);
+        for (int i=0;i<p->count;i++) {
+            const Clarg *a = &p->args[i];
+            if (!a->long_name || !a->long_name[0] || a->kind == ARG_POSITIONAL) continue;
+            int len = (int)strlen(a->long_name);
+            if (len > p->longest) p->longest = len;
+            cl_trie_add(p, a->long_name, i);
+        }
+        cl_trie_seal(p->trie, 0);
+    }
+    p->indexed = 1;
+}
+
+// builds the lookup index; after this the spec is only read, so it may be
+// shared between threads until the next cl_add_* call
+static void cl_freeze(Clargs *p) {
+    if (p && !p->indexed) cl_index(p);
+}
+
+// cl_lookup, also reporting how many slots it visited when probes is set;
+// shorts 0 matches long names only
+static inline int cl_lookup_n(const Clargs *p, const char *name, size_t len, int shorts, int *probes) {
+    if (!name || !p->indexed) return -1;
+    int best = shorts && len == 1 ? p->short_idx[(unsigned char)name[0]] : -1;
+    unsigned h = cl_hash(name, len);
+    unsigned mask = (unsigned)p->nslots - 1, k;
+    for (k = h & mask; p->slots[k].idx >= 0; k = (k + 1) & mask) {
+        if (p->slots[k].hash != h) continue;
+        const char *ln = p->args[p->slots[k].idx].long_name;
+        if (strncmp(ln, name, len) == 0 && ln[len] == '\0') {
+            int i = p->slots[k].idx;
+            if (probes) *probes = (int)((k - h) & mask) + 1;
+            return (best < 0 || i < best) ? i : best;
+        }
+    }
+    if (probes) *probes = (int)((k - h) & mask) + 1;
+    return best;
+}
+
+// looks up a length-delimited name in a frozen spec; a single character
+// also matches short names, and the earlier registration wins when both do
+static int cl_lookup(const Clargs *p, const char *name, size_t len) {
+    return cl_lookup_n(p, name, len, 1, NULL);
+}
+
+// handle of a name in a frozen spec, or -1
+static int cl_handle(const Clargs *p, const char *name) {
+    return name ? cl_lookup(p, name, strlen(name)) : -1;
+}
+
+static int cl_find_idx(Clargs *p, const char *name) {
+    cl_freeze(p);
+    return cl_handle(p, name);
+}
+
+// results 
+
+// allocates a result for an already frozen spec
+static ClResult *cl_result_new(const Clargs *p) {
+    if (!p || !p->indexed) return NULL;
+    ClResult *r = (ClResult*)calloc(1, sizeof(ClResult));
+    if (!r) return NULL;
+    r->spec = p;
+    r->count = p->count;
+    r->vals = (ClValue*)malloc((p->count ? p->count : 1) * sizeof(ClValue));
+    r->present = (uint64_t*)calloc(CL_WORDS(p->count) ? CL_WORDS(p->count) : 1, sizeof(uint64_t));
+    r->pending = (uint64_t*)calloc(CL_WORDS(p->count) ? CL_WORDS(p->count) : 1, sizeof(uint64_t));
+    if (!r->vals || !r->present || !r->pending) { free(r->vals); free(r->present); free(r->pending); free(r); return NULL; }
+    for (int h=0;h<p->count;h++) r->vals[h] = p->args[h].def;
+    r->cmd = -1;
+    r->err_arg = -1;
+    r->err_rule = -1;
+    return r;
+}
+
+// allocates a result for p, freezing it first
+static ClResult *cl_result_create(Clargs *p) {
+    cl_freeze(p);
+    return cl_result_new(p);
+}
+
+static void cl_result_free(ClResult *r) {
+    if (!r) return;
+    cl_result_release(r);
+    free(r);
 }
 
 static int cl_add_flag(Clargs *p, char short_name, const char *long_name, const char *help) {
-    Clarg *a = make_arg();
-    a->short_name = short_name;
-    a->long_name = long_name;
-    a->help = help;
-    a->kind = ARG_FLAG;
-    cl_grow(p);
-    p->args[p->count++] = a;
-    return p->count - 1;
+    cl_new(p, short_name, long_name, NULL, help, ARG_FLAG, 0);
+    return cl_added(p);
 }
 
 static int cl_add_string(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, const char *def) {
-    Clarg *a = make_arg();
-    a->short_name = short_name;
-    a->long_name = long_name;
-    a->meta = meta ? meta : "STR";
-    a->help = help;
-    a->kind = ARG_STRING;
-    a->required = req;
-    a->def_str = def;
-    if (def) a->val_str = strdup(def);
-    cl_grow(p);
-    p->args[p->count++] = a;
-    return p->count - 1;
+    Clarg *a = cl_new(p, short_name, long_name, meta ? meta : "STR", help, ARG_STRING, req);
+    a->def.str = def;
+    return cl_added(p);
 }
 
 // char 
 static int cl_add_char(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, char def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"CHAR"; a->help = help; a->kind = ARG_CHAR; a->required = req; a->def_char = def; a->val_char = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"CHAR", help, ARG_CHAR, req); a->def.c = def; return cl_added(p);
 }
 
 // short 
 static int cl_add_short(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, short def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"SHORT"; a->help = help; a->kind = ARG_SHORT; a->required = req; a->def_short = def; a->val_short = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"SHORT", help, ARG_SHORT, req); a->def.s = def; return cl_added(p);
 }
 
 // int 
 static int cl_add_int(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, int def) {
-    Clarg *a = make_arg();
-    a->short_name = short_name;
-    a->long_name = long_name;
-    a->meta = meta ? meta : "INT";
-    a->help = help;
-    a->kind = ARG_INT;
-    a->required = req;
-    a->def_int = def;
-    a->val_int = def;
-    cl_grow(p);
-    p->args[p->count++] = a;
-    return p->count - 1;
+    Clarg *a = cl_new(p, short_name, long_name, meta ? meta : "INT", help, ARG_INT, req);
+    a->def.i = def;
+    return cl_added(p);
 }
 
 // long 
 static int cl_add_long(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, long def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"LONG"; a->help = help; a->kind = ARG_LONG; a->required = req; a->def_long = def; a->val_long = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"LONG", help, ARG_LONG, req); a->def.l = def; return cl_added(p);
 }
 
 // long long 
 static int cl_add_llong(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, long long def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"LLONG"; a->help = help; a->kind = ARG_LLONG; a->required = req; a->def_llong = def; a->val_llong = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"LLONG", help, ARG_LLONG, req); a->def.ll = def; return cl_added(p);
 }
 
 // unsigned variants 
 static int cl_add_uchar(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, unsigned char def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"UCHAR"; a->help = help; a->kind = ARG_UCHAR; a->required = req; a->def_uchar = def; a->val_uchar = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"UCHAR", help, ARG_UCHAR, req); a->def.uc = def; return cl_added(p);
 }
 static int cl_add_ushort(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, unsigned short def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"USHORT"; a->help = help; a->kind = ARG_USHORT; a->required = req; a->def_ushort = def; a->val_ushort = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"USHORT", help, ARG_USHORT, req); a->def.us = def; return cl_added(p);
 }
 static int cl_add_uint(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, unsigned int def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"UINT"; a->help = help; a->kind = ARG_UINT; a->required = req; a->def_uint = def; a->val_uint = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"UINT", help, ARG_UINT, req); a->def.ui = def; return cl_added(p);
 }
 static int cl_add_ulong(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, unsigned long def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"ULONG"; a->help = help; a->kind = ARG_ULONG; a->required = req; a->def_ulong = def; a->val_ulong = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"ULONG", help, ARG_ULONG, req); a->def.ul = def; return cl_added(p);
 }
 static int cl_add_ullong(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, unsigned long long def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"ULLONG"; a->help = help; a->kind = ARG_ULLONG; a->required = req; a->def_ullong = def; a->val_ullong = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"ULLONG", help, ARG_ULLONG, req); a->def.ull = def; return cl_added(p);
 }
 
 // size_t 
 static int cl_add_size(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, size_t def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"SIZE"; a->help = help; a->kind = ARG_SIZE; a->required = req; a->def_size = def; a->val_size = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"SIZE", help, ARG_SIZE, req); a->def.sz = def; return cl_added(p);
 }
 
 // float 
 static int cl_add_float(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, float def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"FLT"; a->help = help; a->kind = ARG_FLOAT; a->required = req; a->def_float = def; a->val_float = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"FLT", help, ARG_FLOAT, req); a->def.f = def; return cl_added(p);
 }
 
 // double 
 static int cl_add_double(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, double def) {
-    Clarg *a = make_arg(); a->short_name = short_name; a->long_name = long_name; a->meta = meta?meta:"DBL"; a->help = help; a->kind = ARG_DOUBLE; a->required = req; a->def_double = def; a->val_double = def; cl_grow(p); p->args[p->count++] = a; return p->count-1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"DBL", help, ARG_DOUBLE, req); a->def.d = def; return cl_added(p);
 }
 
 static int cl_add_pos(Clargs *p, const char *name, const char *help, int req) {
-    Clarg *a = make_arg();
-    a->long_name = name;
-    a->meta = name;
-    a->help = help;
-    a->kind = ARG_POSITIONAL;
-    a->required = req;
-    cl_grow(p);
-    p->args[p->count++] = a;
-    return p->count - 1;
+    cl_new(p, 0, name, name, help, ARG_POSITIONAL, req);
+    return cl_added(p);
 }
 
-// parsing helpers 
+// an option that collects every value given, repeated or comma-separated,
+// into a contiguous array of kind; the list starts out empty
+static int cl_add_list(Clargs *p, char short_name, const char *long_name, const char *meta, const char *help, int req, ArgKind kind) {
+    if (kind == ARG_FLAG || kind == ARG_POSITIONAL) return -1;
+    Clarg *a = cl_new(p, short_name, long_name, meta?meta:"LIST", help, kind, req); a->multi = 1; return cl_added(p);
+}
 
-static inline int parse_int_simple(const char *s, long *out, int base) {
-    if (!s) return 0;
-    errno = 0;
-    char *end = NULL;
-    long v = strtol(s, &end, base);
-    if (end == s || *end != '\0' || errno) return 0;
-    *out = v;
-    return 1;
+// a positional that takes every remaining word; declare it last
+static int cl_add_pos_list(Clargs *p, const char *name, const char *help, int req) {
+    Clarg *a = cl_new(p, 0, name, name, help, ARG_POSITIONAL, req); a->multi = 1; return cl_added(p);
 }
 
-static inline int parse_llong_simple(const char *s, long long *out, int base) {
-    if (!s) return 0;
-    errno = 0;
-    char *end = NULL;
-    long long v = strtoll(s, &end, base);
-    if (end == s || *end != '\0' || errno) return 0;
-    *out = v;
-    return 1;
+// subcommands 
+
+// registers a subcommand; build fills in its spec the first time a parse
+// selects it, so only the chosen subcommand's arguments are ever added.
+// Returns its index, or -1
+static int cl_add_cmd(Clargs *p, const char *name, const char *help, ClBuildFn build, void *ud) {
+    if (!p || !name || !name[0] || !build) return -1;
+    if (p->ncmds == p->cmdcap) {
+        int cap = p->cmdcap ? p->cmdcap * 2 : 8;
+        ClCmd *cmds = (ClCmd*)realloc(p->cmds, cap * sizeof(ClCmd));
+        if (!cmds) return -1;
+        p->cmds = cmds;
+        p->cmdcap = cap;
+    }
+    ClCmd *c = &p->cmds[p->ncmds];
+    c->name = name;
+    c->help = help;
+    c->build = build;
+    c->ud = ud;
+    c->spec = NULL;
+    c->prog = NULL;
+    p->help_count = -1;
+    return p->ncmds++;
 }
 
-static inline int parse_unsigned_long_simple(const char *s, unsigned long *out, int base) {
-    if (!s) return 0;
-    errno = 0;
-    char *end = NULL;
-    unsigned long v = strtoul(s, &end, base);
-    if (end == s || *end != '\0' || errno) return 0;
-    *out = v;
-    return 1;
+// index of the subcommand called name, or -1
+static int cl_cmd_find(const Clargs *p, const char *name) {
+    for (int i=0;i<p->ncmds;i++) if (!strcmp(p->cmds[i].name, name)) return i;
+    return -1;
 }
 
-static inline int parse_unsigned_llong_simple(const char *s, unsigned long long *out, int base) {
-    if (!s) return 0;
-    errno = 0;
-    char *end = NULL;
-    unsigned long long v = strtoull(s, &end, base);
-    if (end == s || *end != '\0' || errno) return 0;
-    *out = v;
-    return 1;
+// the spec of subcommand i, built and frozen on first use and then kept on
+// the parent; its program name is the parent's followed by the subcommand's
+static Clargs *cl_cmd_spec(Clargs *p, int i) {
+    if (!p || i < 0 || i >= p->ncmds) return NULL;
+    ClCmd *c = &p->cmds[i];
+    size_t n = strlen(p->prog) + strlen(c->name) + 2;
+    if (!c->prog || strncmp(c->prog, p->prog, n - strlen(c->name) - 2) || strcmp(c->prog + n - strlen(c->name) - 1, c->name)) {
+        char *prog = (char*)malloc(n);
+        if (!prog) return NULL;
+        snprintf(prog, n, "%s %s", p->prog, c->name);
+        free(c->prog);
+        c->prog = prog;
+    }
+    if (!c->spec) {
+        c->spec = cl_create_ex(c->prog, c->help, p->flags);
+        c->spec->width = p->width;
+#ifdef CLARGS_STATS
+        cl_stats_hook(c->spec, p->stats_fn, p->stats_ud);
+#endif
+        c->build(c->spec, c->ud);
+    }
+    c->spec->prog = c->prog;
+    cl_freeze(c->spec);
+    return c->spec;
 }
 
-static inline int parse_float_simple(const char *s, float *out) {
-    if (!s) return 0;
-    errno = 0;
-    char *end = NULL;
-    float v = strtof(s, &end);
-    if (end == s || *end != '\0' || errno) return 0;
-    *out = v;
-    return 1;
+// the subcommand selected by the last cl_parse, or -1
+static int cl_cmd(const Clargs *p) {
+    return p ? p->res.cmd : -1;
 }
 
-static inline int parse_double_simple(const char *s, double *out) {
-    if (!s) return 0;
-    errno = 0;
-    char *end = NULL;
-    double v = strtod(s, &end);
-    if (end == s || *end != '\0' || errno) return 0;
-    *out = v;
-    return 1;
+// the spec of the subcommand selected by the last cl_parse, holding its
+// values, or NULL
+static Clargs *cl_cmd_args(Clargs *p) {
+    return p && p->res.cmd >= 0 ? p->cmds[p->res.cmd].spec : NULL;
 }
 
-// help printer 
+// constraints 
 
-static void cl_help(Clargs *p) {
-    printf("Usage: %s", p->prog);
-    for (int i=0;i<p->count;i++) {
-        Clarg *a = p->args[i];
-        if (a->kind == ARG_POSITIONAL) continue;
-        printf(" ");
-        if (!a->required) printf("[");
-        if (a->short_name) {
-            printf("-%c", a->short_name);
-            if (a->kind != ARG_FLAG) printf(" %s", a->meta);
-        } else if (a->long_name) {
-            printf("--%s", a->long_name);
-            if (a->kind != ARG_FLAG) printf(" %s", a->meta);
-        }
-        if (!a->required) printf("]");
-    }
-    for (int i=0;i<p->count;i++) if (p->args[i]->kind == ARG_POSITIONAL) printf(" %s", p->args[i]->meta);
-    printf("\n\n%s\n\n", p->desc && p->desc[0] ? p->desc : "");
-    printf("Options:\n");
+// adds a rule over the n options in hs and returns its index, or -1 for a
+// bad kind or handle. The handles are folded into one mask per bitset word
+// here, so a parse checks the rule with a few word operations
+static int cl_rule(Clargs *p, int kind, int trigger, const int *hs, int n) {
+    if (!p || !hs || n < 1 || kind < CL_RULE_REQUIRES || kind > CL_RULE_ANY_OF) return -1;
+    if (kind == CL_RULE_REQUIRES && (trigger < 0 || trigger >= p->count)) return -1;
+    for (int i=0;i<n;i++) if (hs[i] < 0 || hs[i] >= p->count) return -1;
+    if (p->nrules == p->rulecap) {
+        int cap = p->rulecap ? p->rulecap * 2 : 8;
+        ClRule *rules = (ClRule*)realloc(p->rules, cap * sizeof(ClRule));
+        if (!rules) return -1;
+        p->rules = rules;
+        p->rulecap = cap;
+    }
+    if (p->nmasks + n > p->maskcap) {
+        int cap = p->maskcap ? p->maskcap * 2 : 16;
+        while (cap < p->nmasks + n) cap *= 2;
+        ClMask *masks = (ClMask*)realloc(p->masks, cap * sizeof(ClMask));
+        if (!masks) return -1;
+        p->masks = masks;
+        p->maskcap = cap;
+    }
+    ClRule *u = &p->rules[p->nrules];
+    ClMask *m = &p->masks[p->nmasks];
+    u->kind = kind;
+    u->trigger = kind == CL_RULE_REQUIRES ? trigger : -1;
+    u->first = p->nmasks;
+    u->n = 0;
+    // one mask per word, kept in word order
+    for (int i=0;i<n;i++) {
+        int w = hs[i] >> 6, k = u->n;
+        while (k > 0 && m[k-1].word > w) k--;
+        if (k == 0 || m[k-1].word != w) {
+            memmove(m + k + 1, m + k, (u->n - k) * sizeof(ClMask));
+            m[k].word = w;
+            m[k].bits = 0;
+            u->n++;
+            k++;
+        }
+        m[k-1].bits |= (uint64_t)1 << (hs[i] & 63);
+    }
+    p->nmasks += u->n;
+    return p->nrules++;
+}
+
+// giving h requires giving other as well
+static int cl_requires(Clargs *p, int h, int other) {
+    return cl_rule(p, CL_RULE_REQUIRES, h, &other, 1);
+}
+
+// a and b may not both be given
+static int cl_conflicts(Clargs *p, int a, int b) {
+    int hs[2] = { a, b };
+    return cl_rule(p, CL_RULE_CONFLICTS, -1, hs, 2);
+}
+
+static int cl_exactly_one_of(Clargs *p, const int *hs, int n) {
+    return cl_rule(p, CL_RULE_ONE_OF, -1, hs, n);
+}
+
+static int cl_at_least_one_of(Clargs *p, const int *hs, int n) {
+    return cl_rule(p, CL_RULE_ANY_OF, -1, hs, n);
+}
+
+// bound variables 
+
+// copies the parser's current value of h into the variable registered
+// with cl_bind_*
+static inline void cl_store(const Clargs *p, int h) {
+    const Clarg *a = &p->args[h];
+    if (a->kind == ARG_FLAG) *(int*)a->bind = cl_bit(p->res.present, h);
+    else memcpy(a->bind, &p->res.vals[h], cl_kind_size[a->kind]);
+}
+
+// registers dst to receive the value of handle h; the default is written
+// immediately and cl_parse writes the parsed value when it succeeds
+static int cl_bind_ptr(Clargs *p, int h, ArgKind kind, void *dst) {
+    if (!p || h < 0 || h >= p->count || !dst || p->args[h].multi) return -1;
+    Clarg *a = &p->args[h];
+    if (a->kind != kind && !(kind == ARG_STRING && a->kind == ARG_POSITIONAL)) return -1;
+    a->bind = dst;
+    cl_store(p, h);
+    return 0;
+}
+
+static int cl_bind_flag(Clargs *p, int h, int *dst) { return cl_bind_ptr(p, h, ARG_FLAG, dst); }
+static int cl_bind_string(Clargs *p, int h, const char **dst) { return cl_bind_ptr(p, h, ARG_STRING, (void*)dst); }
+static int cl_bind_char(Clargs *p, int h, char *dst) { return cl_bind_ptr(p, h, ARG_CHAR, dst); }
+static int cl_bind_short(Clargs *p, int h, short *dst) { return cl_bind_ptr(p, h, ARG_SHORT, dst); }
+static int cl_bind_int(Clargs *p, int h, int *dst) { return cl_bind_ptr(p, h, ARG_INT, dst); }
+static int cl_bind_long(Clargs *p, int h, long *dst) { return cl_bind_ptr(p, h, ARG_LONG, dst); }
+static int cl_bind_llong(Clargs *p, int h, long long *dst) { return cl_bind_ptr(p, h, ARG_LLONG, dst); }
+static int cl_bind_uchar(Clargs *p, int h, unsigned char *dst) { return cl_bind_ptr(p, h, ARG_UCHAR, dst); }
+static int cl_bind_ushort(Clargs *p, int h, unsigned short *dst) { return cl_bind_ptr(p, h, ARG_USHORT, dst); }
+static int cl_bind_uint(Clargs *p, int h, unsigned int *dst) { return cl_bind_ptr(p, h, ARG_UINT, dst); }
+static int cl_bind_ulong(Clargs *p, int h, unsigned long *dst) { return cl_bind_ptr(p, h, ARG_ULONG, dst); }
+static int cl_bind_ullong(Clargs *p, int h, unsigned long long *dst) { return cl_bind_ptr(p, h, ARG_ULLONG, dst); }
+static int cl_bind_size(Clargs *p, int h, size_t *dst) { return cl_bind_ptr(p, h, ARG_SIZE, dst); }
+static int cl_bind_float(Clargs *p, int h, float *dst) { return cl_bind_ptr(p, h, ARG_FLOAT, dst); }
+static int cl_bind_double(Clargs *p, int h, double *dst) { return cl_bind_ptr(p, h, ARG_DOUBLE, dst); }
+
+// numeric conversion 
+
+// integers and floats are decoded here rather than with strtol/strtod, so
+// results do not depend on the C locale and errno is left alone on the
+// common path
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// eight ASCII digits in one little-endian word
+static inline int cl_is_8digits(uint64_t v) {
+    return ((v & 0xF0F0F0F0F0F0F0F0ull) | (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+static inline uint64_t cl_8digits(uint64_t v) {
+    v -= 0x3030303030303030ull;
+    v = v * 10 + (v >> 8);
+    return (((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) + (((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+}
+#endif
+
+// reads decimal digits from s up to end or the first non-digit; returns the
+// position after them, or NULL when there are none or the value overflows
+static inline const char *cl_scan_digits(const char *s, const char *end, unsigned long long *out) {
+    const char *start = s;
+    unsigned long long v = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - s >= 8 && v <= (ULLONG_MAX - 99999999ull) / 100000000ull) {
+        uint64_t w;
+        memcpy(&w, s, 8);
+        if (!cl_is_8digits(w)) break;
+        v = v * 100000000ull + cl_8digits(w);
+        s += 8;
+    }
+#endif
+    for (; s < end && (unsigned)(*s - '0') < 10; s++) {
+        unsigned d = (unsigned)(*s - '0');
+        if (v > (ULLONG_MAX - d) / 10) return NULL;
+        v = v * 10 + d;
+    }
+    if (s == start) return NULL;
+    *out = v;
+    return s;
+}
+
+// unsigned magnitude in decimal, or in hex / binary after 0x / 0b
+static inline const char *cl_scan_uint(const char *s, const char *end, unsigned long long *out) {
+    if (end - s < 3 || s[0] != '0' || ((s[1] | 0x20) != 'x' && (s[1] | 0x20) != 'b')) return cl_scan_digits(s, end, out);
+    unsigned shift = (s[1] | 0x20) == 'x' ? 4 : 1;
+    unsigned long long v = 0;
+    const char *start = s += 2;
+    for (; s < end; s++) {
+        unsigned d = (unsigned)(*s - '0');
+        if (shift == 4 && d > 9) d = (unsigned)((*s | 0x20) - 'a') < 6 ? (unsigned)((*s | 0x20) - 'a' + 10) : 16;
+        if (d >= (1u << shift)) break;
+        if (v >> (64 - shift)) return NULL;
+        v = (v << shift) | d;
+    }
+    if (s == start) return NULL;
+    *out = v;
+    return s;
+}
+
+// optional sign, then the magnitude; ARG_SIZE also takes a decimal
+// (K, M, G, T) or binary (Ki, Mi, Gi, Ti) multiplier
+static inline const char *cl_scan_int(const char *s, const char *end, int kind, int *neg, unsigned long long *mag) {
+    *neg = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+')) s++;
+    s = cl_scan_uint(s, end, mag);
+    if (!s || kind != ARG_SIZE || s == end) return s;
+    int e;
+    switch (*s) {
+        case 'K': e = 1; break;
+        case 'M': e = 2; break;
+        case 'G': e = 3; break;
+        case 'T': e = 4; break;
+        default: return s;
+    }
+    s++;
+    unsigned long long base = 1000;
+    if (s < end && *s == 'i') { base = 1024; s++; }
+    while (e--) {
+        if (*mag > ULLONG_MAX / base) return NULL;
+        *mag *= base;
+    }
+    return s;
+}
+
+// range-checks a sign and magnitude for an integer kind and writes it to
+// slot; returns 0 if it does not fit
+static inline int cl_put_int(void *slot, int kind, int neg, unsigned long long v) {
+    long long sv = neg ? (long long)(0 - v) : (long long)v;
+    switch (kind) {
+        case ARG_SHORT: if (v > (unsigned long long)SHRT_MAX + neg) return 0; *(short*)slot = (short)sv; return 1;
+        case ARG_INT: if (v > (unsigned long long)INT_MAX + neg) return 0; *(int*)slot = (int)sv; return 1;
+        case ARG_LONG: if (v > (unsigned long long)LONG_MAX + neg) return 0; *(long*)slot = (long)sv; return 1;
+        case ARG_LLONG: if (v > (unsigned long long)LLONG_MAX + neg) return 0; *(long long*)slot = sv; return 1;
+        default: break;
+    }
+    if (neg && v) return 0;
+    switch (kind) {
+        case ARG_UCHAR: if (v > UCHAR_MAX) return 0; *(unsigned char*)slot = (unsigned char)v; return 1;
+        case ARG_USHORT: if (v > USHRT_MAX) return 0; *(unsigned short*)slot = (unsigned short)v; return 1;
+        case ARG_UINT: if (v > UINT_MAX) return 0; *(unsigned int*)slot = (unsigned int)v; return 1;
+        case ARG_ULONG: if (v > ULONG_MAX) return 0; *(unsigned long*)slot = (unsigned long)v; return 1;
+        case ARG_ULLONG: *(unsigned long long*)slot = v; return 1;
+        case ARG_SIZE: if (v > SIZE_MAX) return 0; *(size_t*)slot = (size_t)v; return 1;
+        default: return 0;
+    }
+}
+
+static inline int cl_is_signed(int kind) {
+    return kind == ARG_SHORT || kind == ARG_INT || kind == ARG_LONG || kind == ARG_LLONG;
+}
+
+// powers of ten that are exact in double / float
+static const double cl_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+static const float cl_pow10f[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+// correctly rounded fallback through strtod/strtof: the text in [s, end)
+// has '.' swapped for the locale's radix character, and errno is restored;
+// returns the position after what was consumed, or NULL on overflow
+static const char *cl_float_slow(const char *s, const char *end, double *out, int single) {
+    const char *point = localeconv()->decimal_point;
+    size_t plen = point && point[0] ? strlen(point) : 1;
+    size_t n = (size_t)(end - s);
+    char small[128], *buf = n * plen < sizeof small ? small : (char*)malloc(n * plen + 1), *w = buf;
+    if (!buf) return NULL;
+    for (const char *c = s; c < end && *c != ','; c++) {
+        if (*c == '.' && plen > 1) { memcpy(w, point, plen); w += plen; }
+        else *w++ = *c == '.' && point && point[0] ? point[0] : *c;
+    }
+    *w = 0;
+    int saved = errno;
+    errno = 0;
+    char *e;
+    if (single) *out = strtof(buf, &e);
+    else *out = strtod(buf, &e);
+    int bad = errno == ERANGE || e == buf;
+    // map the consumed length back onto s, undoing the radix widening
+    size_t used = 0;
+    for (const char *c = buf; c < e; used++) c += (s[used] == '.' ? plen : 1);
+    errno = saved;
+    if (buf != small) free(buf);
+    return bad ? NULL : s + used;
+}
+
+static inline int cl_word(const char *s, const char *end, const char *w) {
+    size_t n = strlen(w);
+    if ((size_t)(end - s) < n) return 0;
+    for (size_t i=0;i<n;i++) if ((s[i] | 0x20) != w[i]) return 0;
+    return 1;
+}
+
+// parses [sign] digits [. digits] [e [sign] digits], inf, infinity or nan;
+// single rounds for float. A mantissa of at most 2^53 (2^24) with a power
+// of ten up to 22 (10) is computed exactly with one rounding (Clinger's
+// fast path); anything longer or further out goes through cl_float_slow.
+// Returns the position after the number, or NULL
+static const char *cl_scan_float(const char *s, const char *end, double *out, int single) {
+    const char *start = s;
+    int neg = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+')) s++;
+    if (cl_word(s, end, "nan")) { *out = neg ? -NAN : NAN; return s + 3; }
+    if (cl_word(s, end, "inf")) { *out = neg ? -HUGE_VAL : HUGE_VAL; return s + (cl_word(s, end, "infinity") ? 8 : 3); }
+    if (end - s >= 2 && s[0] == '0' && (s[1] | 0x20) == 'x') return cl_float_slow(start, end, out, single);
+    uint64_t m = 0;
+    int digits = 0, exp10 = 0, any = 0, trunc = 0;
+    for (; s < end && (unsigned)(*s - '0') < 10; s++, any = 1) {
+        if (digits < 19) { m = m * 10 + (unsigned)(*s - '0'); digits += m != 0; }
+        else { exp10++; trunc |= *s != '0'; }
+    }
+    if (s < end && *s == '.') {
+        for (s++; s < end && (unsigned)(*s - '0') < 10; s++, any = 1) {
+            if (digits < 19) { m = m * 10 + (unsigned)(*s - '0'); digits += m != 0; exp10--; }
+            else trunc |= *s != '0';
+        }
+    }
+    if (!any) return NULL;
+    if (s < end && (*s | 0x20) == 'e') {
+        const char *t = s + 1;
+        int eneg = t < end && *t == '-', e = 0;
+        if (t < end && (*t == '-' || *t == '+')) t++;
+        if (t < end && (unsigned)(*t - '0') < 10) {
+            for (; t < end && (unsigned)(*t - '0') < 10; t++) if (e < 100000) e = e * 10 + (*t - '0');
+            exp10 += eneg ? -e : e;
+            s = t;
+        }
+    }
+#if FLT_EVAL_METHOD == 0
+    if (!trunc) {
+        if (m == 0) { *out = neg ? -0.0 : 0.0; return s; }
+        if (single && m <= (1u << 24) && exp10 >= -10 && exp10 <= 10) {
+            float f = (float)m;
+            f = exp10 < 0 ? f / cl_pow10f[-exp10] : f * cl_pow10f[exp10];
+            *out = neg ? -f : f;
+            return s;
+        }
+        if (!single && m <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+            double d = (double)m;
+            d = exp10 < 0 ? d / cl_pow10[-exp10] : d * cl_pow10[exp10];
+            *out = neg ? -d : d;
+            return s;
+        }
+    }
+#endif
+    const char *e = cl_float_slow(start, s, out, single);
+    return e == s ? s : NULL;
+}
+
+// scalar integer value: leading blanks are skipped as strtol did, the
+// rest must be a whole number that fits kind
+static int cl_convert_int(void *slot, int kind, const char *val) {
+    while (cl_isspace(*val)) val++;
+    const char *end = val + strlen(val);
+    int neg;
+    unsigned long long mag;
+    return cl_scan_int(val, end, kind, &neg, &mag) == end && cl_put_int(slot, kind, neg, mag);
+}
+
+static int cl_convert_float(void *slot, int single, const char *val) {
+    while (cl_isspace(*val)) val++;
+    const char *end = val + strlen(val);
+    double d;
+    if (cl_scan_float(val, end, &d, single) != end) return 0;
+    if (single) *(float*)slot = (float)d;
+    else *(double*)slot = d;
+    return 1;
+}
+
+// list decoding 
+
+#ifndef CL_LIST_RANGE_MAX
+#define CL_LIST_RANGE_MAX (1 << 20)    // most values one lo..hi range may expand to
+#endif
+
+// appends every value of lo..hi; both ends are already range-checked
+static int cl_list_range(ClResult *r, int h, int kind, int nlo, unsigned long long lo, int nhi, unsigned long long hi) {
+    size_t w = cl_kind_size[kind];
+    unsigned long long count;
+    if (cl_is_signed(kind)) {
+        long long a = nlo ? (long long)(0 - lo) : (long long)lo, b = nhi ? (long long)(0 - hi) : (long long)hi;
+        if (b < a || (unsigned long long)b - (unsigned long long)a >= CL_LIST_RANGE_MAX) return 0;
+        count = (unsigned long long)b - (unsigned long long)a + 1;
+        char *slot = (char*)cl_list_reserve(r, h, (int)count);
+        if (!slot) return 0;
+        for (long long x = a;; x++, slot += w) {
+            cl_put_int(slot, kind, x < 0, x < 0 ? 0 - (unsigned long long)x : (unsigned long long)x);
+            if (x == b) break;
+        }
+    } else {
+        if (hi < lo || hi - lo >= CL_LIST_RANGE_MAX) return 0;
+        count = hi - lo + 1;
+        char *slot = (char*)cl_list_reserve(r, h, (int)count);
+        if (!slot) return 0;
+        for (unsigned long long x = lo;; x++, slot += w) {
+            cl_put_int(slot, kind, 0, x);
+            if (x == hi) break;
+        }
+    }
+    r->lists[h].n += (int)count;
+    return 1;
+}
+
+// appends the values in val to the list of h: a comma-separated word is
+// split, integer kinds also take lo..hi ranges; returns 0 on a malformed
+// or out-of-range element
+static int cl_list_add(ClResult *r, int h, const char *val) {
+    const Clarg *a = &r->spec->args[h];
+    int kind = a->kind;
+    size_t len = strlen(val);
+    const char *s = val, *end = val + len;
+    if (kind == ARG_POSITIONAL) return cl_list_add_str(r, h, val, len, 1);
+    if (kind == ARG_STRING) {
+        const char *c = (const char*)memchr(s, ',', len);
+        if (!c) return cl_list_add_str(r, h, val, len, 1);
+        for (;;) {
+            size_t n = c ? (size_t)(c - s) : (size_t)(end - s);
+            if (!cl_list_add_str(r, h, s, n, 0)) return 0;
+            if (!c) return 1;
+            s = c + 1;
+            c = (const char*)memchr(s, ',', (size_t)(end - s));
+        }
+    }
+    // one slot per comma plus one, reserved up front; only ranges grow it
+    // inside the loop
+    int n = 1;
+    for (const char *c = s; (c = (const char*)memchr(c, ',', (size_t)(end - c))); c++) n++;
+    if (!cl_list_reserve(r, h, n)) return 0;
+    size_t w = cl_kind_size[kind];
+    for (;;) {
+        if (r->lists[h].n == r->lists[h].cap && !cl_list_reserve(r, h, 1)) return 0;
+        char *slot = (char*)r->lists[h].data + w * r->lists[h].n;
+        if (kind == ARG_CHAR) {
+            if (s >= end || *s == ',' || (s + 1 < end && s[1] != ',')) return 0;
+            *slot = *s++;
+            r->lists[h].n++;
+        } else if (kind == ARG_FLOAT || kind == ARG_DOUBLE) {
+            double d;
+            const char *c = (const char*)memchr(s, ',', (size_t)(end - s));
+            if (cl_scan_float(s, c ? c : end, &d, kind == ARG_FLOAT) != (c ? c : end)) return 0;
+            if (kind == ARG_FLOAT) *(float*)slot = (float)d;
+            else *(double*)slot = d;
+            s = c ? c : end;
+            r->lists[h].n++;
+        } else {
+            int neg, nhi;
+            unsigned long long v, hi;
+            s = cl_scan_int(s, end, kind, &neg, &v);
+            if (!s || !cl_put_int(slot, kind, neg, v)) return 0;
+            if (end - s >= 2 && s[0] == '.' && s[1] == '.') {
+                s = cl_scan_int(s + 2, end, kind, &nhi, &hi);
+                if (!s || !cl_put_int(slot, kind, nhi, hi) || !cl_list_range(r, h, kind, neg, v, nhi, hi)) return 0;
+            } else {
+                r->lists[h].n++;
+            }
+        }
+        if (s == end) return 1;
+        if (*s != ',' || ++s == end) return 0;
+    }
+}
+
+// kind names used in "Bad <kind> for ..." messages
+static const char *const cl_kind_name[] = {
+    "flag", "string", "char", "short", "int", "long", "long long",
+    "uchar", "ushort", "uint", "ulong", "ullong", "size", "float", "double", "positional"
+};
+
+// converts val according to the kind of h and stores it in r; returns 0 if
+// val is malformed or out of range
+static int cl_convert(ClResult *r, int h, const char *val) {
+    ClValue *v = &r->vals[h];
+    CL_STAT(r, conversions[r->spec->args[h].kind], 1);
+    if (r->spec->args[h].multi) return cl_list_add(r, h, val);
+    switch (r->spec->args[h].kind) {
+        case ARG_STRING: case ARG_POSITIONAL: cl_strfree(r, h); v->str = cl_strdup(r, val); return v->str != NULL;
+        case ARG_CHAR: if (!val[0]) return 0; v->c = val[0]; return 1;
+        case ARG_SHORT: case ARG_INT: case ARG_LONG: case ARG_LLONG:
+        case ARG_UCHAR: case ARG_USHORT: case ARG_UINT: case ARG_ULONG: case ARG_ULLONG: case ARG_SIZE:
+            return cl_convert_int(v, r->spec->args[h].kind, val);
+        case ARG_FLOAT: return cl_convert_float(v, 1, val);
+        case ARG_DOUBLE: return cl_convert_float(v, 0, val);
+        default: return 1;
+    }
+}
+
+// text buffers 
+
+static int cl_buf_grow(ClBuf *b, size_t extra) {
+    if (b->err) return 0;
+    if (b->n + extra + 1 <= b->cap) return 1;
+    size_t cap = b->cap ? b->cap : 1024;
+    while (cap < b->n + extra + 1) cap *= 2;
+    char *s = (char*)realloc(b->s, cap);
+    if (!s) { b->err = 1; return 0; }
+    b->s = s;
+    b->cap = cap;
+    return 1;
+}
+
+static void cl_buf_put(ClBuf *b, const char *s, size_t n) {
+    if (!cl_buf_grow(b, n)) return;
+    memcpy(b->s + b->n, s, n);
+    b->n += n;
+    b->s[b->n] = 0;
+}
+
+static inline void cl_buf_str(ClBuf *b, const char *s) {
+    if (s) cl_buf_put(b, s, strlen(s));
+}
+
+static void cl_buf_pad(ClBuf *b, char c, int n) {
+    if (n <= 0 || !cl_buf_grow(b, (size_t)n)) return;
+    memset(b->s + b->n, c, (size_t)n);
+    b->n += (size_t)n;
+    b->s[b->n] = 0;
+}
+
+static void cl_buf_fmt(ClBuf *b, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->s ? b->s + b->n : NULL, b->s ? b->cap - b->n : 0, fmt, ap);
+    va_end(ap);
+    if (n < 0) { b->err = 1; return; }
+    if (b->s && b->n + (size_t)n < b->cap) { b->n += (size_t)n; return; }
+    if (!cl_buf_grow(b, (size_t)n)) return;
+    va_start(ap, fmt);
+    vsnprintf(b->s + b->n, b->cap - b->n, fmt, ap);
+    va_end(ap);
+    b->n += (size_t)n;
+}
+
+// appends text, breaking lines at spaces before column width and indenting
+// continuation lines to indent; width 0 appends it unchanged. *col tracks
+// the current column
+static void cl_buf_wrap(ClBuf *b, const char *text, int *col, int indent, int width) {
+    if (!text) return;
+    if (width <= 0) { size_t n = strlen(text); cl_buf_put(b, text, n); *col += (int)n; return; }
+    while (*text) {
+        int sp = 0, wl = 0;
+        while (text[sp] == ' ') sp++;
+        while (text[sp + wl] && text[sp + wl] != ' ') wl++;
+        if (wl && *col > indent && *col + sp + wl > width) {
+            cl_buf_put(b, "\n", 1);
+            cl_buf_pad(b, ' ', indent);
+            *col = indent;
+        } else {
+            cl_buf_put(b, text, (size_t)sp);
+            *col += sp;
+        }
+        cl_buf_put(b, text + sp, (size_t)wl);
+        *col += wl;
+        text += sp + wl;
+    }
+}
+
+// everything written goes out in one write(2) after stdio is flushed
+static void cl_write_out(const char *s, size_t n) {
+    fflush(stdout);
+#ifdef CL_HAVE_UNISTD
+    while (n) {
+        ssize_t k = write(1, s, n);
+        if (k < 0) { if (errno == EINTR) continue; return; }
+        s += k;
+        n -= (size_t)k;
+    }
+#else
+    fwrite(s, 1, n, stdout);
+    fflush(stdout);
+#endif
+}
+
+// help printer 
+
+// sets the column help text wraps at: 0 (the default) never wraps,
+// CL_WIDTH_TERMINAL asks the terminal on stdout, then $COLUMNS
+static void cl_set_width(Clargs *p, int cols) {
+    if (p) p->width = cols;
+}
+
+static int cl_term_width(int width) {
+    if (width != CL_WIDTH_TERMINAL) return width > 0 ? width : 0;
+#if defined(CL_HAVE_UNISTD) && defined(TIOCGWINSZ)
+    struct winsize ws;
+    if (ioctl(1, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) return ws.ws_col;
+#endif
+    const char *env = getenv("COLUMNS");
+    int cols = env ? atoi(env) : 0;
+    return cols > 0 ? cols : 0;
+}
+
+// appends " (default: ...)" for an option whose kind shows one
+static void cl_default_text(const Clarg *a, ClBuf *out) {
+    switch (a->multi ? (int)ARG_FLAG : a->kind) {
+        case ARG_STRING: if (a->def.str) cl_buf_fmt(out, " (default: %s)", a->def.str); break;
+        case ARG_CHAR: cl_buf_fmt(out, " (default: %c)", a->def.c); break;
+        case ARG_SHORT: cl_buf_fmt(out, " (default: %d)", a->def.s); break;
+        case ARG_INT: cl_buf_fmt(out, " (default: %d)", a->def.i); break;
+        case ARG_LONG: cl_buf_fmt(out, " (default: %ld)", a->def.l); break;
+        case ARG_LLONG: cl_buf_fmt(out, " (default: %lld)", (long long)a->def.ll); break;
+        case ARG_UCHAR: cl_buf_fmt(out, " (default: %u)", (unsigned)a->def.uc); break;
+        case ARG_USHORT: cl_buf_fmt(out, " (default: %u)", (unsigned)a->def.us); break;
+        case ARG_UINT: cl_buf_fmt(out, " (default: %u)", a->def.ui); break;
+        case ARG_ULONG: cl_buf_fmt(out, " (default: %lu)", a->def.ul); break;
+        case ARG_ULLONG: cl_buf_fmt(out, " (default: %llu)", (unsigned long long)a->def.ull); break;
+        case ARG_SIZE: cl_buf_fmt(out, " (default: %zu)", a->def.sz); break;
+        case ARG_FLOAT: cl_buf_fmt(out, " (default: %.6g)", (double)a->def.f); break;
+        case ARG_DOUBLE: cl_buf_fmt(out, " (default: %.6g)", a->def.d); break;
+        default: break;
+    }
+}
+
+// "-v, --verbose META" as shown in the options table
+static void cl_option_label(const Clargs *p, int i, ClBuf *b) {
+    const Clarg *a = &p->args[i];
+    if (a->short_name) { cl_buf_fmt(b, "-%c", a->short_name); if (a->long_name) cl_buf_put(b, ", ", 2); }
+    if (a->long_name) cl_buf_fmt(b, "--%s", a->long_name);
+    if (a->kind != ARG_FLAG) cl_buf_fmt(b, " %s%s", p->info[i].meta ? p->info[i].meta : "", a->multi ? ",..." : "");
+}
+
+#define CL_HELP_COLUMN 30   // width of the option column before the help text
+
+// renders usage and help in one pass per section: the usage line, the
+// description, then the options and positionals tables
+static void cl_render_help(const Clargs *p, ClBuf *b, int width) {
+    int col, indent;
+    ClBuf def;
+    memset(&def, 0, sizeof def);
+    cl_buf_fmt(b, "Usage: %s", p->prog);
+    col = (int)b->n;
+    indent = width && col + 1 > width / 2 ? 8 : col + 1;
+    for (int pass=0;pass<2;pass++) {
+        for (int i=0;i<p->count;i++) {
+            const Clarg *a = &p->args[i];
+            size_t at = b->n;
+            if ((a->kind == ARG_POSITIONAL) != pass) continue;
+            cl_buf_put(b, " ", 1);
+            if (pass) cl_buf_fmt(b, "%s%s", p->info[i].meta ? p->info[i].meta : "", a->multi ? "..." : "");
+            else {
+                if (!a->required) cl_buf_put(b, "[", 1);
+                if (a->short_name) cl_buf_fmt(b, "-%c", a->short_name);
+                else if (a->long_name) cl_buf_fmt(b, "--%s", a->long_name);
+                if ((a->short_name || a->long_name) && a->kind != ARG_FLAG) cl_buf_fmt(b, " %s%s", p->info[i].meta, a->multi ? ",..." : "");
+                if (!a->required) cl_buf_put(b, "]", 1);
+            }
+            int len = (int)(b->n - at);
+            if (width && col >= indent && col + len > width && cl_buf_grow(b, (size_t)indent)) {
+                // move the item just written onto a new line, its leading
+                // space becoming the line break
+                memmove(b->s + at + 1 + indent, b->s + at + 1, (size_t)len - 1);
+                b->s[at] = '\n';
+                memset(b->s + at + 1, ' ', (size_t)indent);
+                b->n = at + indent + len;
+                b->s[b->n] = 0;
+                col = indent + len - 1;
+            } else col += len;
+        }
+    }
+    if (p->ncmds) cl_buf_str(b, " <command> ...");
+    cl_buf_put(b, "\n\n", 2);
+    col = 0;
+    cl_buf_wrap(b, p->desc && p->desc[0] ? p->desc : "", &col, 0, width);
+    cl_buf_str(b, "\n\nOptions:\n");
+    int any = 0;
     for (int i=0;i<p->count;i++) {
-        Clarg *a = p->args[i];
-        if (a->kind == ARG_POSITIONAL) continue;
-        char buf[128] = "";
-        if (a->short_name) { sprintf(buf+strlen(buf), "-%c", a->short_name); if (a->long_name) strcat(buf, ", "); }
-        if (a->long_name) sprintf(buf+strlen(buf), "--%s", a->long_name);
-        if (a->kind != ARG_FLAG) sprintf(buf+strlen(buf), " %s", a->meta ? a->meta : "");
-        printf("  %-30s %s", buf, a->help ? a->help : "");
-        switch (a->kind) {
-            case ARG_STRING: if (a->def_str) printf(" (default: %s)", a->def_str); break;
-            case ARG_CHAR: printf(" (default: %c)", a->def_char); break;
-            case ARG_SHORT: printf(" (default: %d)", a->def_short); break;
-            case ARG_INT: printf(" (default: %d)", a->def_int); break;
-            case ARG_LONG: printf(" (default: %ld)", a->def_long); break;
-            case ARG_LLONG: printf(" (default: %lld)", (long long)a->def_llong); break;
-            case ARG_UCHAR: printf(" (default: %u)", (unsigned)a->def_uchar); break;
-            case ARG_USHORT: printf(" (default: %u)", (unsigned)a->def_ushort); break;
-            case ARG_UINT: printf(" (default: %u)", a->def_uint); break;
-            case ARG_ULONG: printf(" (default: %lu)", a->def_ulong); break;
-            case ARG_ULLONG: printf(" (default: %llu)", (unsigned long long)a->def_ullong); break;
-            case ARG_SIZE: printf(" (default: %zu)", a->def_size); break;
-            case ARG_FLOAT: printf(" (default: %.6g)", (double)a->def_float); break;
-            case ARG_DOUBLE: printf(" (default: %.6g)", a->def_double); break;
-            default: break;
-        }
-        if (a->required) printf(" [required]");
-        printf("\n");
-    }
-    int any = 0; for (int i=0;i<p->count;i++) if (p->args[i]->kind == ARG_POSITIONAL) any = 1;
-    if (any) {
-        printf("\nPositional:\n");
+        const Clarg *a = &p->args[i];
+        if (a->kind == ARG_POSITIONAL) { any = 1; continue; }
+        size_t at = b->n;
+        cl_buf_put(b, "  ", 2);
+        cl_option_label(p, i, b);
+        int len = (int)(b->n - at) - 2;
+        indent = width && width - (CL_HELP_COLUMN + 3) < 20 ? 8 : CL_HELP_COLUMN + 3;
+        if (width && len > CL_HELP_COLUMN) {
+            // an overlong label gets its help on the next line when wrapping
+            cl_buf_put(b, "\n", 1);
+            cl_buf_pad(b, ' ', indent);
+            col = indent;
+        } else {
+            cl_buf_pad(b, ' ', CL_HELP_COLUMN - len);
+            cl_buf_put(b, " ", 1);
+            col = 2 + (len > CL_HELP_COLUMN ? len : CL_HELP_COLUMN) + 1;
+        }
+        cl_buf_wrap(b, p->info[i].help ? p->info[i].help : "", &col, indent, width);
+        def.n = 0;
+        cl_default_text(a, &def);
+        if (def.n) cl_buf_wrap(b, def.s, &col, indent, width);
+        if (a->required) cl_buf_wrap(b, " [required]", &col, indent, width);
+        cl_buf_put(b, "\n", 1);
+    }
+    if (any) cl_buf_str(b, "\nPositional:\n");
+    for (int i=0;i<p->count && any;i++) {
+        const Clarg *a = &p->args[i];
+        if (a->kind != ARG_POSITIONAL) continue;
+        const char *meta = p->info[i].meta ? p->info[i].meta : "";
+        int len = (int)strlen(meta);
+        cl_buf_fmt(b, "  %s", meta);
+        cl_buf_pad(b, ' ', CL_HELP_COLUMN - len);
+        cl_buf_put(b, " ", 1);
+        col = 2 + (len > CL_HELP_COLUMN ? len : CL_HELP_COLUMN) + 1;
+        indent = width && width - (CL_HELP_COLUMN + 3) < 20 ? 8 : CL_HELP_COLUMN + 3;
+        cl_buf_wrap(b, p->info[i].help ? p->info[i].help : "", &col, indent, width);
+        if (a->required) cl_buf_wrap(b, " [required]", &col, indent, width);
+        cl_buf_put(b, "\n", 1);
+    }
+    if (p->ncmds) cl_buf_str(b, "\nCommands:\n");
+    for (int i=0;i<p->ncmds;i++) {
+        int len = (int)strlen(p->cmds[i].name);
+        cl_buf_fmt(b, "  %s", p->cmds[i].name);
+        cl_buf_pad(b, ' ', CL_HELP_COLUMN - len);
+        cl_buf_put(b, " ", 1);
+        col = 2 + (len > CL_HELP_COLUMN ? len : CL_HELP_COLUMN) + 1;
+        indent = width && width - (CL_HELP_COLUMN + 3) < 20 ? 8 : CL_HELP_COLUMN + 3;
+        cl_buf_wrap(b, p->cmds[i].help ? p->cmds[i].help : "", &col, indent, width);
+        cl_buf_put(b, "\n", 1);
+    }
+    if (def.err) b->err = 1;
+    free(def.s);
+}
+
+// the full help text, rendered on first use and kept on the spec until an
+// argument is added, the program name changes or the width does
+static const char *cl_help_text(Clargs *p, size_t *len) {
+    int width = cl_term_width(p->width);
+    if (p->help.err || p->help_prog != p->prog || p->help_count != p->count || p->help_width != width) {
+        p->help.n = 0;
+        p->help.err = 0;
+        cl_render_help(p, &p->help, width);
+        p->help_prog = p->prog;
+        p->help_count = p->count;
+        p->help_width = width;
+    }
+    if (p->help.err) { if (len) *len = 0; return NULL; }
+    if (len) *len = p->help.n;
+    return p->help.s;
+}
+
+static void cl_help(Clargs *p) {
+    size_t n;
+    const char *text = cl_help_text(p, &n);
+    if (text) cl_write_out(text, n);
+}
+
+// shell completion 
+
+// the options word could become, one per line, appended to b. Long names
+// come from the prefix tree; a lone "-" or an empty word lists every option
+static void cl_complete_text(const Clargs *p, const char *word, ClBuf *b) {
+    if (!word) word = "";
+    if (word[0] == '-' && word[1] == '-') {
+        int node = cl_trie_find(p, word + 2, strlen(word + 2));
+        int *hs = node >= 0 ? (int*)malloc((size_t)(p->count ? p->count : 1) * sizeof(int)) : NULL;
+        int k = hs ? cl_trie_list(p->trie, node, hs, 0, p->count) : 0;
+        for (int j=0;j<k;j++) { cl_buf_put(b, "--", 2); cl_buf_str(b, p->args[hs[j]].long_name); cl_buf_put(b, "\n", 1); }
+        free(hs);
+    } else if (!word[0] || (word[0] == '-' && !word[1])) {
+        for (int i=0;i<p->count;i++) if (p->args[i].short_name) cl_buf_fmt(b, "-%c\n", p->args[i].short_name);
+        for (int i=0;i<p->count;i++)
+            if (p->args[i].long_name && p->args[i].kind != ARG_POSITIONAL) cl_buf_fmt(b, "--%s\n", p->args[i].long_name);
+    }
+    // a word that is not an option may be a subcommand
+    if (word[0] != '-')
+        for (int i=0;i<p->ncmds;i++)
+            if (!strncmp(p->cmds[i].name, word, strlen(word))) cl_buf_fmt(b, "%s\n", p->cmds[i].name);
+}
+
+// answers the hidden --__complete query on stdout
+static void cl_complete(const Clargs *p, const char *word) {
+    ClBuf b;
+    memset(&b, 0, sizeof b);
+    cl_complete_text(p, word, &b);
+    if (b.n) cl_write_out(b.s, b.n);
+    free(b.s);
+}
+
+// appends s with every character in quote escaped by a backslash, and a
+// single quote closed and reopened ('\'') when sq is set
+static void cl_buf_esc(ClBuf *b, const char *s, const char *quote, int sq) {
+    for (; s && *s; s++) {
+        if (*s == '\'' && sq) cl_buf_put(b, "'\\''", 4);
+        else if (*s == '\n') cl_buf_put(b, " ", 1);
+        else {
+            if (strchr(quote, *s)) cl_buf_put(b, "\\", 1);
+            cl_buf_put(b, s, 1);
+        }
+    }
+}
+
+// bash, zsh or fish completion script for the program, written to stdout;
+// the option lists are baked in so completing never runs the program.
+// Returns -1 for an unknown shell
+static int cl_completion(Clargs *p, const char *shell) {
+    const char *name = strrchr(p->prog, '/') ? strrchr(p->prog, '/') + 1 : p->prog;
+    int fish = shell && !strcmp(shell, "fish"), zsh = shell && !strcmp(shell, "zsh");
+    if (!shell || (!fish && !zsh && strcmp(shell, "bash"))) return -1;
+    ClBuf b, fn;
+    memset(&b, 0, sizeof b);
+    memset(&fn, 0, sizeof fn);
+    cl_buf_str(&fn, "_");
+    for (const char *c=name;*c;c++) cl_buf_put(&fn, (*c >= '0' && *c <= '9') || (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ? c : "_", 1);
+    int anypos = 0;
+    for (int i=0;i<p->count;i++) if (p->args[i].kind == ARG_POSITIONAL) anypos = 1;
+    if (fish) {
+        for (int i=0;i<p->count;i++) {
+            const Clarg *a = &p->args[i];
+            if (a->kind == ARG_POSITIONAL || (!a->short_name && !a->long_name)) continue;
+            cl_buf_fmt(&b, "complete -c %s", name);
+            if (a->short_name) cl_buf_fmt(&b, " -s %c", a->short_name);
+            if (a->long_name) cl_buf_fmt(&b, " -l %s", a->long_name);
+            if (a->kind != ARG_FLAG) cl_buf_str(&b, " -r");
+            if (p->info[i].help) { cl_buf_str(&b, " -d '"); cl_buf_esc(&b, p->info[i].help, "\\'", 0); cl_buf_str(&b, "'"); }
+            cl_buf_put(&b, "\n", 1);
+        }
+        for (int i=0;i<p->ncmds;i++) {
+            cl_buf_fmt(&b, "complete -c %s -f -n __fish_use_subcommand -a %s", name, p->cmds[i].name);
+            if (p->cmds[i].help) { cl_buf_str(&b, " -d '"); cl_buf_esc(&b, p->cmds[i].help, "\\'", 0); cl_buf_str(&b, "'"); }
+            cl_buf_put(&b, "\n", 1);
+        }
+    } else if (zsh) {
+        cl_buf_fmt(&b, "#compdef %s\n\n%s() {\n    _arguments -s \\\n", name, fn.s);
+        for (int i=0;i<p->count;i++) {
+            const Clarg *a = &p->args[i];
+            if (a->kind == ARG_POSITIONAL || (!a->short_name && !a->long_name)) continue;
+            cl_buf_str(&b, "        ");
+            if (a->multi) cl_buf_str(&b, "'*'");
+            if (a->short_name && a->long_name && a->multi) cl_buf_fmt(&b, "{-%c,--%s}'", a->short_name, a->long_name);
+            else if (a->short_name && a->long_name) cl_buf_fmt(&b, "'(-%c --%s)'{-%c,--%s}'", a->short_name, a->long_name, a->short_name, a->long_name);
+            else if (a->short_name) cl_buf_fmt(&b, "'-%c", a->short_name);
+            else cl_buf_fmt(&b, "'--%s", a->long_name);
+            cl_buf_put(&b, "[", 1);
+            cl_buf_esc(&b, p->info[i].help, "[]:\\", 1);
+            cl_buf_put(&b, "]", 1);
+            if (a->kind != ARG_FLAG) {
+                cl_buf_put(&b, ":", 1);
+                cl_buf_esc(&b, p->info[i].meta, ":\\", 1);
+                cl_buf_str(&b, a->kind == ARG_STRING ? ":_files" : ":");
+            }
+            cl_buf_str(&b, "' \\\n");
+        }
+        if (p->ncmds) {
+            // the subcommand is the first word; whatever follows is its own
+            cl_buf_str(&b, "        '1:command:((");
+            for (int i=0;i<p->ncmds;i++) {
+                cl_buf_fmt(&b, "%s%s\\:", i ? " " : "", p->cmds[i].name);
+                cl_buf_esc(&b, p->cmds[i].help, ":\\ ()", 1);
+            }
+            cl_buf_str(&b, "))' \\\n");
+        }
+        cl_buf_fmt(&b, "        %s\n}\n\n%s \"$@\"\n", p->ncmds ? "'*::file:_files'" : anypos ? "'*:file:_files'" : "", fn.s);
+    } else {
+        cl_buf_fmt(&b, "%s() {\n    local cur=${COMP_WORDS[COMP_CWORD]} prev=${COMP_WORDS[COMP_CWORD-1]}\n    case $prev in\n        ", fn.s);
+        int any = 0;
         for (int i=0;i<p->count;i++) {
-            Clarg *a = p->args[i]; if (a->kind != ARG_POSITIONAL) continue;
-            printf("  %-30s %s", a->meta, a->help ? a->help : "");
-            if (a->required) printf(" [required]");
-            printf("\n");
+            const Clarg *a = &p->args[i];
+            if (a->kind == ARG_POSITIONAL || a->kind == ARG_FLAG) continue;
+            if (a->short_name) { cl_buf_fmt(&b, "%s-%c", any ? "|" : "", a->short_name); any = 1; }
+            if (a->long_name) { cl_buf_fmt(&b, "%s--%s", any ? "|" : "", a->long_name); any = 1; }
         }
+        cl_buf_str(&b, any ? ") return ;;\n    esac\n" : "--) return ;;\n    esac\n");
+        if (p->ncmds) {
+            cl_buf_str(&b, "    if [[ $cur != -* ]]; then\n        COMPREPLY=($(compgen -W '");
+            for (int i=0;i<p->ncmds;i++) cl_buf_fmt(&b, "%s%s", i ? " " : "", p->cmds[i].name);
+            cl_buf_str(&b, "' -- \"$cur\"))\n        return\n    fi\n");
+        } else cl_buf_str(&b, "    [[ $cur == -* ]] || return\n");
+        cl_buf_str(&b, "    COMPREPLY=($(compgen -W '--help");
+        for (int i=0;i<p->count;i++) {
+            const Clarg *a = &p->args[i];
+            if (a->kind == ARG_POSITIONAL) continue;
+            if (a->short_name) cl_buf_fmt(&b, " -%c", a->short_name);
+            if (a->long_name) cl_buf_fmt(&b, " --%s", a->long_name);
+        }
+        cl_buf_fmt(&b, "' -- \"$cur\"))\n}\ncomplete -o default -F %s %s\n", fn.s, name);
     }
+    int rc = b.err || fn.err ? -1 : 0;
+    if (!rc) cl_write_out(b.s, b.n);
+    free(b.s);
+    free(fn.s);
+    return rc;
 }
 
 // parsing 
 
-static int cl_parse(Clargs *p, int argc, char **argv) {
-    if (!p) return -1;
-    if (argc > 0) p->prog = argv[0];
+static inline int cl_fail(ClResult *r, int code, int tok, int off, int arg) {
+    r->err = code;
+    r->err_tok = tok;
+    r->err_off = off;
+    r->err_arg = arg;
+    return code;
+}
+
+// lazy conversion 
+
+// stores val for h, or under CL_LAZY only notes where it is; lists still
+// convert at once since every occurrence adds to them
+static inline int cl_take(ClResult *r, int h, const char *val, int tok, int off) {
+    if (!(r->spec->flags & CL_LAZY) || r->spec->args[h].multi) {
+        cl_bit_set(r->present, h);
+        CL_CLOCK(t);
+        int ok = cl_convert(r, h, val);
+        CL_LAP(r, CL_PHASE_CONVERT, t);
+        return ok;
+    }
+    cl_bit_set(r->present, h);
+    cl_bit_set(r->pending, h);
+    r->raw[h].val = val;
+    r->raw[h].tok = tok;
+    r->raw[h].off = off;
+    return 1;
+}
+
+// converts the recorded value of h; a bad value is recorded in r as if the
+// parse had failed on it and stays pending, so every read reports it
+static int cl_settle(ClResult *r, int h) {
+    const ClRaw *w = &r->raw[h];
+    CL_CLOCK(t);
+    int ok = cl_convert(r, h, w->val);
+    CL_LAP(r, CL_PHASE_CONVERT, t);
+    if (ok) { cl_bit_clr(r->pending, h); return 1; }
+    cl_fail(r, cl_is_str(&r->spec->args[h]) ? CL_ERR_NOMEM : CL_ERR_BAD_VALUE, w->tok, w->off, h);
+    return 0;
+}
+
+// whether h is a valid handle whose value can be read, converting it first
+// if it is pending; results are only ever allocated mutable
+static inline int cl_ready(const ClResult *r, int h) {
+    if (h < 0 || h >= r->count) return 0;
+    return !cl_bit(r->pending, h) || cl_settle((ClResult*)r, h);
+}
+
+// converts every pending value, as a strict parse would have; returns the
+// status of the bad value with the lowest handle, or CL_OK. The argv that
+// was parsed must still be alive
+static int cl_resolve(ClResult *r) {
+    int first = -1;
+    for (int h=0;h<r->count;h++)
+        if (cl_bit(r->pending, h) && !cl_settle(r, h) && first < 0) first = h;
+    if (first < 0) return CL_OK;
+    cl_settle(r, first);
+    return r->err;
+}
+
+// checks every rule in one pass over their masks. The first broken rule is
+// recorded with the handle that breaks it: the first one missing, or the
+// second one given when too many are
+static int cl_check_rules(const Clargs *p, ClResult *r) {
+    for (int i=0;i<p->nrules;i++) {
+        const ClRule *u = &p->rules[i];
+        if (u->kind == CL_RULE_REQUIRES && !cl_bit(r->present, u->trigger)) continue;
+        const ClMask *m = &p->masks[u->first];
+        int given = 0, all = 1;
+        for (int k=0;k<u->n;k++) {
+            uint64_t got = r->present[m[k].word] & m[k].bits;
+            given += cl_popcount(got);
+            all &= got == m[k].bits;
+        }
+        int ok;
+        switch (u->kind) {
+            case CL_RULE_REQUIRES: ok = all; break;
+            case CL_RULE_CONFLICTS: ok = given <= 1; break;
+            case CL_RULE_ONE_OF: ok = given == 1; break;
+            default: ok = given >= 1; break;
+        }
+        if (ok) continue;
+        int h = -1, skip = given > 1 && u->kind != CL_RULE_REQUIRES;
+        for (int k=0;k<u->n && h < 0;k++) {
+            uint64_t bits = m[k].bits;
+            if (u->kind == CL_RULE_REQUIRES) bits &= ~r->present[m[k].word];
+            else if (given) bits &= r->present[m[k].word];
+            for (; bits && h < 0; bits &= bits - 1) {
+                if (skip) { skip = 0; continue; }
+                h = m[k].word * 64 + cl_lowest(bits);
+            }
+        }
+        r->err_rule = i;
+        return cl_fail(r, CL_ERR_CONSTRAINT, 0, 0, h);
+    }
+    return CL_OK;
+}
+
+// cl_lookup_n for the parser and the layers; counted and timed in
+// CLARGS_STATS builds
+static inline int cl_parse_lookup(const Clargs *p, ClResult *r, const char *name, size_t len, int shorts) {
+#ifdef CLARGS_STATS
+    int n = 0;
+    CL_CLOCK(t);
+    int h = cl_lookup_n(p, name, len, shorts, &n);
+    CL_LAP(r, CL_PHASE_LOOKUP, t);
+    r->stats.lookups++;
+    r->stats.probes += n;
+    if (n > r->stats.max_probe) r->stats.max_probe = n;
+    return h;
+#else
+    (void)r;
+    return cl_lookup_n(p, name, len, shorts, NULL);
+#endif
+}
+
+// required arguments, then the rules, once every value is in
+static int cl_validate(const Clargs *p, ClResult *r) {
+    CL_CLOCK(t);
+    int rc = CL_OK;
+    for (int w=0;w<CL_WORDS(p->count);w++) {
+        uint64_t missing = p->required[w] & ~r->present[w];
+        if (missing) { rc = cl_fail(r, CL_ERR_REQUIRED, 0, 0, w * 64 + cl_lowest(missing)); break; }
+    }
+    if (rc == CL_OK) rc = cl_check_rules(p, r);
+    CL_LAP(r, CL_PHASE_VALIDATE, t);
+    return rc;
+}
+
+static int cl_parse_argv(const Clargs *p, ClResult *r, int argc, char **argv) {
+    if (r->spec != p || !p->indexed || r->count != p->count) return cl_fail(r, CL_ERR_SPEC, 0, 0, -1);
+    cl_result_reset(r);
+    if ((p->flags & CL_LAZY) && r->nraw < r->count) {
+        ClRaw *raw = (ClRaw*)realloc(r->raw, r->count * sizeof(ClRaw));
+        CL_STAT_ALLOC(r, r->count * sizeof(ClRaw));
+        if (!raw) return cl_fail(r, CL_ERR_NOMEM, 0, 0, -1);
+        r->raw = raw;
+        r->nraw = r->count;
+    }
+    if ((p->flags & CL_RESPONSE) && argc > 0) {
+        int i = 1;
+        while (i < argc && argv[i][0] != '@') i++;
+        if (i < argc) {
+            for (int k=0;k<argc;k++) {
+                int rc = k ? cl_expand(r, argv[k], 0) : (cl_xpush(r, argv[0]) ? CL_OK : CL_ERR_NOMEM);
+                if (rc != CL_OK) return cl_fail(r, rc, rc == CL_ERR_RESPONSE ? r->nx - 1 : 0, 0, -1);
+            }
+            argc = r->nx;
+            argv = r->xargv;
+        }
+    }
+    if (argc > 1 && !strcmp(argv[1], "--__complete")) return cl_fail(r, CL_COMPLETE, 1, 0, -1);
     for (int i=1;i<argc;i++) {
         char *tok = argv[i];
-        if (!strcmp(tok, "--help") || !strcmp(tok, "-h")) { cl_help(p); exit(0); }
+        CL_STAT(r, tokens, 1);
+        if (!strcmp(tok, "--help") || !strcmp(tok, "-h")) return cl_fail(r, CL_HELP, i, 0, -1);
         if (tok[0] == '-' && tok[1] == '-') {
-            char *eq = strchr(tok, '=');
-            char name[128];
-            const char *val = NULL;
-            if (eq) { int n = eq - (tok + 2); strncpy(name, tok+2, n); name[n]=0; val = eq+1; }
-            else strcpy(name, tok+2);
-            int idx = cl_find_idx(p, name);
-            if (idx < 0) { fprintf(stderr, "Unknown option: %s\n", tok); return -1; }
-            Clarg *a = p->args[idx]; a->present = 1;
-            if (a->kind == ARG_FLAG) continue;
-            if (!val) { if (i+1 >= argc) { fprintf(stderr, "Missing value for --%s\n", name); return -1; } val = argv[++i]; }
-            switch (a->kind) {
-                case ARG_STRING: if (a->val_str) free(a->val_str); a->val_str = strdup(val); break;
-                case ARG_CHAR: if (!val[0]) { fprintf(stderr, "Bad char for --%s\n", name); return -1; } a->val_char = val[0]; break;
-                case ARG_SHORT: { long tmp; if (!parse_int_simple(val, &tmp, 10)) { fprintf(stderr, "Bad short for --%s\n", name); return -1; } a->val_short = (short)tmp; break; }
-                case ARG_INT: { long tmp; if (!parse_int_simple(val, &tmp, 10)) { fprintf(stderr, "Bad int for --%s\n", name); return -1; } a->val_int = (int)tmp; break; }
-                case ARG_LONG: { long tmp; if (!parse_int_simple(val, &tmp, 10)) { fprintf(stderr, "Bad long for --%s\n", name); return -1; } a->val_long = tmp; break; }
-                case ARG_LLONG: { long long tmp; if (!parse_llong_simple(val, &tmp, 10)) { fprintf(stderr, "Bad long long for --%s\n", name); return -1; } a->val_llong = tmp; break; }
-                case ARG_UCHAR: { unsigned long tmp; if (!parse_unsigned_long_simple(val, &tmp, 10) || tmp > UCHAR_MAX) { fprintf(stderr, "Bad uchar for --%s\n", name); return -1; } a->val_uchar = (unsigned char)tmp; break; }
-                case ARG_USHORT: { unsigned long tmp; if (!parse_unsigned_long_simple(val, &tmp, 10) || tmp > USHRT_MAX) { fprintf(stderr, "Bad ushort for --%s\n", name); return -1; } a->val_ushort = (unsigned short)tmp; break; }
-                case ARG_UINT: { unsigned long tmp; if (!parse_unsigned_long_simple(val, &tmp, 10) || tmp > UINT_MAX) { fprintf(stderr, "Bad uint for --%s\n", name); return -1; } a->val_uint = (unsigned int)tmp; break; }
-                case ARG_ULONG: { unsigned long tmp; if (!parse_unsigned_long_simple(val, &tmp, 10)) { fprintf(stderr, "Bad ulong for --%s\n", name); return -1; } a->val_ulong = tmp; break; }
-                case ARG_ULLONG: { unsigned long long tmp; if (!parse_unsigned_llong_simple(val, &tmp, 10)) { fprintf(stderr, "Bad ullong for --%s\n", name); return -1; } a->val_ullong = tmp; break; }
-                case ARG_SIZE: { unsigned long tmp; if (!parse_unsigned_long_simple(val, &tmp, 10)) { fprintf(stderr, "Bad size for --%s\n", name); return -1; } a->val_size = (size_t)tmp; break; }
-                case ARG_FLOAT: { float tmp; if (!parse_float_simple(val, &tmp)) { fprintf(stderr, "Bad float for --%s\n", name); return -1; } a->val_float = tmp; break; }
-                case ARG_DOUBLE: { double tmp; if (!parse_double_simple(val, &tmp)) { fprintf(stderr, "Bad double for --%s\n", name); return -1; } a->val_double = tmp; break; }
-                default: break;
+            const char *name = tok + 2;
+            const char *eq = strchr(name, '=');
+            int n = eq ? (int)(eq - name) : (int)strlen(name);
+            const char *val = eq ? eq + 1 : NULL;
+            int idx = cl_parse_lookup(p, r, name, (size_t)n, 1);
+            if (idx < 0 && (p->flags & CL_ABBREV)) {
+                CL_CLOCK(t);
+                idx = cl_prefix(p, name, (size_t)n);
+                CL_LAP(r, CL_PHASE_LOOKUP, t);
+                CL_STAT(r, lookups, 1);
             }
+            if (idx == -2) return cl_fail(r, CL_ERR_AMBIGUOUS, i, 0, -1);
+            if (idx < 0) return cl_fail(r, CL_ERR_UNKNOWN, i, 0, -1);
+            if (p->args[idx].kind == ARG_FLAG) { cl_bit_set(r->present, idx); continue; }
+            int at = i;
+            if (!val) { if (i+1 >= argc) return cl_fail(r, CL_ERR_MISSING_VALUE, i, 0, idx); val = argv[++i]; }
+            if (!cl_take(r, idx, val, at, 0)) return cl_fail(r, cl_is_str(&p->args[idx]) ? CL_ERR_NOMEM : CL_ERR_BAD_VALUE, at, 0, idx);
         } else if (tok[0] == '-' && tok[1]) {
             int len = (int)strlen(tok);
             for (int k=1;k<len;k++) {
-                char ch = tok[k];
-                char n[2] = { ch, 0 };
-                int idx = cl_find_idx(p, n);
-                if (idx < 0) { fprintf(stderr, "Unknown -%c\n", ch); return -1; }
-                Clarg *a = p->args[idx];
-                a->present = 1;
-                if (a->kind == ARG_FLAG) continue;
+                int idx = cl_parse_lookup(p, r, &tok[k], 1, 1);
+                if (idx < 0) return cl_fail(r, CL_ERR_UNKNOWN, i, k, -1);
+                if (p->args[idx].kind == ARG_FLAG) { cl_bit_set(r->present, idx); continue; }
                 const char *val = NULL;
+                int at = i, off = k;
                 if (k+1 < len) { val = &tok[k+1]; k = len; }
-                else { if (i+1 >= argc) { fprintf(stderr, "Missing value for -%c\n", ch); return -1; } val = argv[++i]; }
-                switch (a->kind) {
-                    case ARG_STRING: if (a->val_str) free(a->val_str); a->val_str = strdup(val); break;
-                    case ARG_CHAR: if (!val[0]) { fprintf(stderr, "Bad char for -%c\n", ch); return -1; } a->val_char = val[0]; break;
-                    case ARG_SHORT: { long tmp; if (!parse_int_simple(val, &tmp, 10)) { fprintf(stderr, "Bad short for -%c\n", ch); return -1; } a->val_short = (short)tmp; break; }
-                    case ARG_INT: { long tmp; if (!parse_int_simple(val, &tmp, 10)) { fprintf(stderr, "Bad int for -%c\n", ch); return -1; } a->val_int = (int)tmp; break; }
-                    case ARG_LONG: { long tmp; if (!parse_int_simple(val, &tmp, 10)) { fprintf(stderr, "Bad long for -%c\n", ch); return -1; } a->val_long = tmp; break; }
-                    case ARG_LLONG: { long long tmp; if (!parse_llong_simple(val, &tmp, 10)) { fprintf(stderr, "Bad long long for -%c\n", ch); return -1; } a->val_llong = tmp; break; }
-                    case ARG_UCHAR: { unsigned long tmp; if (!parse_unsigned_long_simple(val, &tmp, 10) || tmp > UCHAR_MAX) { fprintf(stderr, "Bad uchar for -%c\n", ch); return -1; } a->val_uchar = (unsigned char)tmp; break; }
-                    case ARG_USHORT: { unsigned long tmp; if (!parse_unsigned_long_simple(val, &tmp, 10) || tmp > USHRT_MAX) { fprintf(stderr, "Bad ushort for -%c\n", ch); return -1; } a->val_ushort = (unsigned short)tmp; break; }
-                    case ARG_UINT: { unsigned long tmp; if (!parse_unsigned_long_simple(val, &tmp, 10) || tmp > UINT_MAX) { fprintf(stderr, "Bad uint for -%c\n", ch); return -1; } a->val_uint = (unsigned int)tmp; break; }
-                    case ARG_ULONG: { unsigned long tmp; if (!parse_unsigned_long_simple(val, &tmp, 10)) { fprintf(stderr, "Bad ulong for -%c\n", ch); return -1; } a->val_ulong = tmp; break; }
-                    case ARG_ULLONG: { unsigned long long tmp; if (!parse_unsigned_llong_simple(val, &tmp, 10)) { fprintf(stderr, "Bad ullong for -%c\n", ch); return -1; } a->val_ullong = tmp; break; }
-                    case ARG_SIZE: { unsigned long tmp; if (!parse_unsigned_long_simple(val, &tmp, 10)) { fprintf(stderr, "Bad size for -%c\n", ch); return -1; } a->val_size = (size_t)tmp; break; }
-                    case ARG_FLOAT: { float tmp; if (!parse_float_simple(val, &tmp)) { fprintf(stderr, "Bad float for -%c\n", ch); return -1; } a->val_float = tmp; break; }
-                    case ARG_DOUBLE: { double tmp; if (!parse_double_simple(val, &tmp)) { fprintf(stderr, "Bad double for -%c\n", ch); return -1; } a->val_double = tmp; break; }
-                    default: break;
-                }
+                else { if (i+1 >= argc) return cl_fail(r, CL_ERR_MISSING_VALUE, i, k, idx); val = argv[++i]; }
+                if (!cl_take(r, idx, val, at, off)) return cl_fail(r, cl_is_str(&p->args[idx]) ? CL_ERR_NOMEM : CL_ERR_BAD_VALUE, at, off, idx);
             }
+        } else if (p->ncmds) {
+            // the first word is the subcommand; the rest of argv is its own
+            r->cmd = cl_cmd_find(p, tok);
+            if (r->cmd < 0) return cl_fail(r, CL_ERR_COMMAND, i, 0, -1);
+            r->cmd_tok = i;
+            break;
         } else {
-            int ok = 0;
-            for (int j=0;j<p->count;j++) {
-                Clarg *a = p->args[j];
-                if (a->kind == ARG_POSITIONAL && !a->present) {
-                    a->present = 1;
-                    if (a->val_str) free(a->val_str);
-                    a->val_str = strdup(tok);
-                    ok = 1;
-                    break;
-                }
+            if (r->npos >= p->npos) return cl_fail(r, CL_ERR_UNEXPECTED, i, 0, -1);
+            int idx = p->pos[r->npos];
+            if (!p->args[idx].multi) r->npos++;
+            if (!cl_take(r, idx, tok, i, 0)) return cl_fail(r, CL_ERR_NOMEM, i, 0, idx);
+        }
+    }
+
+    return cl_validate(p, r);
+}
+
+// parses argv into r against a frozen spec without touching the spec,
+// stdout, stderr or bound variables, so one spec can serve many threads
+// as long as each uses its own result
+static int cl_parse_r(const Clargs *p, ClResult *r, int argc, char **argv) {
+    if (!p || !r) return CL_ERR_SPEC;
+#ifdef CLARGS_STATS
+    memset(&r->stats, 0, sizeof r->stats);
+    // the reset at the start of the parse keeps at most the newest arena
+    // block; blocks chained in front of it are this parse's
+    const void *kept = r->arena.buf ? NULL : r->arena.blocks;
+    CL_CLOCK(t);
+    int rc = cl_parse_argv(p, r, argc, argv);
+    long long total = cl_now_ns() - t;
+    ClStats *st = &r->stats;
+    for (const void *b = r->arena.blocks; b && b != kept; b = *(void *const *)b) CL_STAT_ALLOC(r, ((const size_t*)b)[1]);
+    st->ns[CL_PHASE_TOKENIZE] = total - st->ns[CL_PHASE_LOOKUP] - st->ns[CL_PHASE_CONVERT] - st->ns[CL_PHASE_VALIDATE];
+    if (p->stats_fn) p->stats_fn(r, r->nx ? r->xargv : argv, p->stats_ud);
+    return rc;
+#else
+    return cl_parse_argv(p, r, argc, argv);
+#endif
+}
+
+// an argument as it is written on the command line, to stderr
+static void cl_perror_name(const Clargs *p, int h) {
+    const Clarg *a = &p->args[h];
+    if (a->kind == ARG_POSITIONAL) fprintf(stderr, "%s", p->info[h].meta ? p->info[h].meta : "(pos)");
+    else if (a->long_name) fprintf(stderr, "--%s", a->long_name);
+    else fprintf(stderr, "-%c", a->short_name);
+}
+
+// the variable the environment layer reads for h: PREFIX_LONG_NAME
+static void cl_env_name(const Clargs *p, int h, char *out, size_t size) {
+    const char *pre = p->env_prefix ? p->env_prefix : "";
+    size_t k = strlen(pre) + 1;
+    snprintf(out, size, "%s_%s", pre, p->args[h].long_name ? p->args[h].long_name : "");
+    for (char *c = out + (k < size ? k : size - 1); *c; c++)
+        *c = *c == '-' ? '_' : *c >= 'a' && *c <= 'z' ? (char)(*c - 32) : *c;
+}
+
+// errors from the environment and config file layers
+static void cl_perror_layer(const Clargs *p, const ClResult *r) {
+    const char *kind = r->err_arg >= 0 ? cl_kind_name[p->args[r->err_arg].kind] : "";
+    const char *key = r->err_text ? r->err_text : "";
+    if (r->err == CL_ERR_NOMEM) { fprintf(stderr, "Out of memory\n"); return; }
+    if (r->err_src == CL_SRC_ENV) {
+        char var[256];
+        cl_env_name(p, r->err_arg, var, sizeof var);
+        fprintf(stderr, "Bad %s in $%s\n", kind, var);
+        return;
+    }
+    if (r->err == CL_ERR_CONFIG && !r->err_tok) { fprintf(stderr, "Cannot read config file %s\n", p->config); return; }
+    fprintf(stderr, "%s:%d: ", p->config, r->err_tok);
+    switch (r->err) {
+        case CL_ERR_UNKNOWN: {
+            fprintf(stderr, "Unknown option: %s\n", key);
+            int s = cl_suggest(p, key, strlen(key));
+            if (s >= 0) fprintf(stderr, "Did you mean %s?\n", p->args[s].long_name);
+            break;
+        }
+        case CL_ERR_MISSING_VALUE: fprintf(stderr, "Missing value for %s\n", key); break;
+        case CL_ERR_BAD_VALUE: fprintf(stderr, "Bad %s for %s\n", kind, key); break;
+        default: fprintf(stderr, "Malformed line\n"); break;
+    }
+}
+
+// prints the message for the error recorded in r, in the format cl_parse
+// has always used; argv must be the vector that was parsed
+static void cl_perror(const Clargs *p, const ClResult *r, char **argv) {
+    if (r->err_src != CL_SRC_ARGV) { cl_perror_layer(p, r); return; }
+    if (r->nx) argv = r->xargv;
+    const char *tok = argv && r->err_tok > 0 ? argv[r->err_tok] : "";
+    const char *name = (tok[0] == '-' && tok[1] == '-') ? tok + 2 : tok;
+    int n = (int)strcspn(name, "=");
+    char ch = r->err_off && tok[0] ? tok[r->err_off] : 0;
+    const char *kind = r->err_arg >= 0 ? cl_kind_name[p->args[r->err_arg].kind] : "";
+    switch (r->err) {
+        case CL_ERR_UNKNOWN:
+            if (ch) fprintf(stderr, "Unknown -%c\n", ch);
+            else {
+                fprintf(stderr, "Unknown option: %s\n", tok);
+                int s = tok[0] == '-' && tok[1] == '-' ? cl_suggest(p, name, (size_t)n) : -1;
+                if (s >= 0) fprintf(stderr, "Did you mean --%s?\n", p->args[s].long_name);
             }
-            if (!ok) { fprintf(stderr, "Unexpected arg %s\n", tok); return -1; }
+            break;
+        case CL_ERR_AMBIGUOUS: {
+            int hs[8];
+            int k = cl_trie_list(p->trie, cl_trie_find(p, name, (size_t)n), hs, 0, 8);
+            fprintf(stderr, "Ambiguous option: --%.*s could be", n, name);
+            for (int j=0;j<k;j++) fprintf(stderr, "%s --%s", j ? "," : "", p->args[hs[j]].long_name);
+            fprintf(stderr, "%s\n", k == 8 ? ", ..." : "");
+            break;
+        }
+        case CL_ERR_MISSING_VALUE:
+            if (ch) fprintf(stderr, "Missing value for -%c\n", ch);
+            else fprintf(stderr, "Missing value for --%.*s\n", n, name);
+            break;
+        case CL_ERR_BAD_VALUE:
+            if (ch) fprintf(stderr, "Bad %s for -%c\n", kind, ch);
+            else fprintf(stderr, "Bad %s for --%.*s\n", kind, n, name);
+            break;
+        case CL_ERR_UNEXPECTED: fprintf(stderr, "Unexpected arg %s\n", tok); break;
+        case CL_ERR_REQUIRED: {
+            const Clarg *a = &p->args[r->err_arg];
+            if (a->kind == ARG_POSITIONAL) fprintf(stderr, "Missing %s\n", p->info[r->err_arg].meta ? p->info[r->err_arg].meta : "(pos)");
+            else fprintf(stderr, "Missing --%s\n", a->long_name ? a->long_name : "(arg)");
+            break;
         }
+        case CL_ERR_NOMEM: fprintf(stderr, "Out of memory\n"); break;
+        case CL_ERR_SPEC: fprintf(stderr, "Parser spec changed after the result was created\n"); break;
+        case CL_ERR_RESPONSE: fprintf(stderr, "Cannot read response file %s\n", tok[0] == '@' ? tok + 1 : tok); break;
+        case CL_ERR_COMMAND: fprintf(stderr, "Unknown command: %s\n", tok); break;
+        case CL_ERR_CONSTRAINT: {
+            const ClRule *u = &p->rules[r->err_rule];
+            if (u->kind == CL_RULE_REQUIRES) {
+                cl_perror_name(p, u->trigger);
+                fprintf(stderr, " requires ");
+                cl_perror_name(p, r->err_arg);
+                fprintf(stderr, "\n");
+                break;
+            }
+            int given = cl_bit(r->present, r->err_arg), j = 0;
+            fprintf(stderr, given ? "Only one of " : "One of ");
+            for (int k=0;k<u->n;k++)
+                for (uint64_t bits = p->masks[u->first + k].bits; bits; bits &= bits - 1) {
+                    if (j++) fprintf(stderr, ", ");
+                    cl_perror_name(p, p->masks[u->first + k].word * 64 + cl_lowest(bits));
+                }
+            fprintf(stderr, given ? " may be given\n" : " is required\n");
+            break;
+        }
+        default: break;
     }
+}
 
-    for (int i=0;i<p->count;i++) {
-        Clarg *a = p->args[i];
-        if (a->kind == ARG_STRING) {
-            if (!a->val_str && a->def_str) a->val_str = strdup(a->def_str);
-            if (a->required && !a->val_str) { fprintf(stderr, "Missing --%s\n", a->long_name ? a->long_name : "(arg)"); return -1; }
+// the enumerator name of a ClStatus, such as "CL_ERR_UNKNOWN"
+static const char *cl_status_name(int code) {
+    static const char *const names[] = {
+        "CL_ERR_CONFIG", "CL_ERR_SNAPSHOT", "CL_ERR_CONSTRAINT", "CL_ERR_COMMAND", "CL_ERR_AMBIGUOUS", "CL_ERR_RESPONSE", "CL_ERR_SPEC", "CL_ERR_NOMEM", "CL_ERR_REQUIRED",
+        "CL_ERR_UNEXPECTED", "CL_ERR_BAD_VALUE", "CL_ERR_MISSING_VALUE", "CL_ERR_UNKNOWN", "CL_OK", "CL_HELP", "CL_COMPLETE"
+    };
+    return code >= CL_ERR_CONFIG && code <= CL_COMPLETE ? names[code - CL_ERR_CONFIG] : "?";
+}
+
+// the error recorded in a result, as data rather than text
+typedef struct {
+    int code;               // ClStatus
+    int tok;                // argv index of the offending token (config file: line), 0 if none
+    int off;                // offset of the short option within it, 0 otherwise
+    int arg;                // handle involved, or -1
+    int rule;               // rule broken, for CL_ERR_CONSTRAINT, or -1
+    const char *token;      // argv[tok] (config file: the key), or NULL
+    const char *option;     // long name (positional: meta) of arg, or NULL
+    int src;                // ClSource the error came from
+} ClError;
+
+// fills e from r and returns its code; argv is the vector that was parsed
+// and may be NULL when the token is not wanted
+static int cl_error(const ClResult *r, char **argv, ClError *e) {
+    if (r->nx) argv = r->xargv;
+    const Clargs *p = r->spec;
+    e->code = r->err;
+    e->tok = r->err_tok;
+    e->off = r->err_off;
+    e->arg = r->err_arg;
+    e->rule = r->err_rule;
+    e->token = r->err_src != CL_SRC_ARGV ? r->err_text : argv && r->err < 0 && r->err_tok > 0 ? argv[r->err_tok] : NULL;
+    e->src = r->err_src;
+    e->option = NULL;
+    if (r->err_arg >= 0 && r->err_arg < r->count)
+        e->option = p->args[r->err_arg].kind == ARG_POSITIONAL ? p->info[r->err_arg].meta : p->args[r->err_arg].long_name;
+    return e->code;
+}
+
+static int cl_parse_layers(const Clargs *p, ClResult *r, int argc, char **argv);
+
+// cl_parse once the program name is set; recurses into the subcommand
+static int cl_run(Clargs *p, int argc, char **argv) {
+    cl_freeze(p);
+    int rc = cl_parse_layers(p, &p->res, argc, argv);
+    if (rc == CL_HELP) { cl_help(p); exit(0); }
+    if (rc == CL_COMPLETE) { cl_complete(p, argc > 2 ? argv[2] : ""); exit(0); }
+    // bound variables are written now, so their lazy values are converted now
+    for (int h=0;h<p->count && rc == CL_OK;h++)
+        if (p->args[h].bind && cl_bit(p->res.pending, h) && !cl_settle(&p->res, h)) rc = p->res.err;
+    if (rc != CL_OK) { cl_perror(p, &p->res, argv); return -1; }
+    // only a complete parse reaches the bound variables; after an error
+    // they keep what they held before
+    for (int h=0;h<p->count;h++) if (p->args[h].bind) cl_store(p, h);
+    if (p->res.cmd < 0) return 0;
+    // global options are in; the subcommand parses from its own name on
+    Clargs *sub = cl_cmd_spec(p, p->res.cmd);
+    if (!sub) { fprintf(stderr, "Out of memory\n"); return -1; }
+    if (p->res.nx) { argc = p->res.nx; argv = p->res.xargv; }
+    return cl_run(sub, argc - p->res.cmd_tok, argv + p->res.cmd_tok);
+}
+
+// parses into the parser's own result, printing errors and handling
+// --help the way it always has; bound variables are updated on return.
+// A subcommand is parsed into its own spec (see cl_cmd_args)
+static int cl_parse(Clargs *p, int argc, char **argv) {
+    if (!p) return -1;
+    if (argc > 0) p->prog = argv[0];
+    return cl_run(p, argc, argv);
+}
+
+// batch parsing 
+
+// called once per command line with the result still holding its values;
+// returning nonzero stops the batch
+typedef int (*ClLineFn)(const ClResult *r, int line, int status, int argc, char **argv, void *ud);
+
+// parses n command lines against one spec, reusing r for every line so
+// nothing is reallocated between lines; returns the number that parsed
+// cleanly
+static int cl_parse_batch(const Clargs *p, ClResult *r, int n, const int *argcs, char ***argvs, ClLineFn fn, void *ud) {
+    int good = 0;
+    for (int i=0;i<n;i++) {
+        int rc = cl_parse_r(p, r, argcs[i], argvs[i]);
+        if (rc == CL_OK) good++;
+        if (fn && fn(r, i, rc, argcs[i], argvs[i], ud)) break;
+    }
+    return good;
+}
+
+// parses a newline-delimited buffer where each non-empty line is a
+// whitespace-separated argv vector (argv[0] included); separators are
+// overwritten with NULs in place, so buf must be writable and string
+// values point into it in CL_BORROW mode. An unterminated last line is
+// copied into r, so its values stay valid like the others. The argv given
+// to fn lives only for the call. Returns -1 if out of memory
+static int cl_parse_lines(const Clargs *p, ClResult *r, char *buf, size_t len, ClLineFn fn, void *ud) {
+    int good = 0, line = 0, cap = 16;
+    char **toks = (char**)malloc(cap * sizeof(char*));
+    if (!toks) return -1;
+    size_t at = 0;
+    while (at < len) {
+        char *s = buf + at;
+        char *nl = (char*)memchr(s, '\n', len - at);
+        size_t n = nl ? (size_t)(nl - s) : len - at;
+        at += n + 1;
+        if (!nl) {
+            // the last line has no terminator to overwrite, so copy it
+            char *tail = (char*)realloc(r->tail, n + 1);
+            if (!tail) { free(toks); return -1; }
+            memcpy(tail, s, n);
+            r->tail = s = tail;
         }
-        if ((a->kind == ARG_CHAR || a->kind == ARG_SHORT || a->kind == ARG_INT || a->kind == ARG_LONG || a->kind == ARG_LLONG
-             || a->kind == ARG_UCHAR || a->kind == ARG_USHORT || a->kind == ARG_UINT || a->kind == ARG_ULONG || a->kind == ARG_ULLONG
-             || a->kind == ARG_SIZE || a->kind == ARG_FLOAT || a->kind == ARG_DOUBLE) && a->required && !a->present) {
-            fprintf(stderr, "Missing --%s\n", a->long_name ? a->long_name : "(arg)");
-            return -1;
+        s[n] = 0;
+        int argc = 0;
+        for (char *c = s; *c; ) {
+            while (*c == ' ' || *c == '\t' || *c == '\r') *c++ = 0;
+            if (!*c) break;
+            if (argc + 1 >= cap) {
+                char **t = (char**)realloc(toks, cap * 2 * sizeof(char*));
+                if (!t) { free(toks); return -1; }
+                toks = t;
+                cap *= 2;
+            }
+            toks[argc++] = c;
+            while (*c && *c != ' ' && *c != '\t' && *c != '\r') c++;
         }
-        if (a->kind == ARG_POSITIONAL && a->required && !a->present) { fprintf(stderr, "Missing %s\n", a->meta ? a->meta : "(pos)"); return -1; }
+        if (!argc) continue;
+        toks[argc] = NULL;
+        int rc = cl_parse_r(p, r, argc, toks);
+        if (rc == CL_OK) good++;
+        if (fn && fn(r, line, rc, argc, toks, ud)) break;
+        line++;
     }
-    return 0;
+    free(toks);
+    return good;
 }
 
-// finder and getters 
+// columnar results: one ClValue column and one presence column per option,
+// so a whole batch is decoded into a few flat arrays
+typedef struct {
+    const Clargs *spec;
+    int rows;               // rows filled by the last cl_parse_table
+    int cap;                // rows allocated
+    int count;              // columns (options)
+    ClValue *cols;          // column-major: cols[h * cap + row]
+    unsigned char *present; // same layout as cols
+    int *status;            // ClStatus of each row
+    ClArena *arenas;        // string copies, one arena per worker
+    int narenas;
+} ClTable;
 
-static Clarg *cl_find(Clargs *p, const char *name) {
-    if (!name) return NULL;
-    for (int i=0;i<p->count;i++) {
-        Clarg *a = p->args[i];
-        if (a->long_name && strcmp(a->long_name, name) == 0) return a;
-        if (strlen(name) == 1 && a->short_name == name[0]) return a;
-        if (a->kind == ARG_POSITIONAL && a->meta && strcmp(a->meta, name) == 0) return a;
+static void cl_table_free(ClTable *t) {
+    if (!t) return;
+    for (int i=0;i<t->narenas;i++) cl_arena_free(&t->arenas[i]);
+    free(t->arenas);
+    free(t->cols);
+    free(t->present);
+    free(t->status);
+    free(t);
+}
+
+// makes room for n rows and n workers' arenas, discarding previous rows
+static int cl_table_prepare(ClTable *t, int n, int workers) {
+    if (n > t->cap) {
+        int cap = t->cap ? t->cap : 64;
+        while (cap < n) cap *= 2;
+        free(t->cols); free(t->present); free(t->status);
+        t->cols = (ClValue*)malloc((size_t)cap * (t->count ? t->count : 1) * sizeof(ClValue));
+        t->present = (unsigned char*)malloc((size_t)cap * (t->count ? t->count : 1));
+        t->status = (int*)malloc((size_t)cap * sizeof(int));
+        t->cap = t->cols && t->present && t->status ? cap : 0;
+        if (!t->cap) return CL_ERR_NOMEM;
+    }
+    if (workers > t->narenas) {
+        ClArena *a = (ClArena*)realloc(t->arenas, workers * sizeof(ClArena));
+        if (!a) return CL_ERR_NOMEM;
+        memset(a + t->narenas, 0, (workers - t->narenas) * sizeof(ClArena));
+        t->arenas = a;
+        t->narenas = workers;
     }
+    for (int i=0;i<t->narenas;i++) cl_arena_reset(&t->arenas[i]);
+    t->rows = n;
+    return CL_OK;
+}
+
+// a row holds one ClValue per option, which has no room for a list
+static int cl_table_ok(const Clargs *p) {
+    for (int h=0;h<p->count;h++) if (p->args[h].multi) return 0;
+    return 1;
+}
+
+// cap pre-sizes the row storage; it grows on demand either way. NULL if
+// the spec has list options (cl_add_list, cl_add_pos_list)
+static ClTable *cl_table_create(Clargs *p, int cap) {
+    if (!p || !cl_table_ok(p)) return NULL;
+    cl_freeze(p);
+    ClTable *t = (ClTable*)calloc(1, sizeof(ClTable));
+    if (!t) return NULL;
+    t->spec = p;
+    t->count = p->count;
+    t->narenas = 1;
+    t->arenas = (ClArena*)calloc(1, sizeof(ClArena));
+    if (!t->arenas) { free(t); return NULL; }
+    if (cap > 0 && cl_table_prepare(t, cap, 1) != CL_OK) { cl_table_free(t); return NULL; }
+    t->rows = 0;
+    return t;
+}
+
+// copies one parsed line into row of the table; owned strings are moved
+// into the worker's arena so the result can be reset for the next line
+static void cl_table_put(ClTable *t, ClArena *ar, int row, const ClResult *r, int status) {
+    const Clargs *p = t->spec;
+    size_t stride = (size_t)t->cap;
+    for (int h=0;h<t->count;h++) {
+        ClValue v = r->vals[h];
+        if (cl_is_str(&p->args[h]) && v.str && v.str != p->args[h].def.str && (!(p->flags & CL_BORROW) || cl_mapped(r, v.str))) {
+            size_t n = strlen(v.str) + 1;
+            char *d = (char*)cl_arena_alloc(ar, n);
+            if (d) memcpy(d, v.str, n);
+            v.str = d;
+        }
+        t->cols[h * stride + row] = v;
+        t->present[h * stride + row] = (unsigned char)cl_bit(r->present, h);
+    }
+    t->status[row] = status;
+}
+
+static int cl_table_fill(ClTable *t, ClResult *r, ClArena *ar, int from, int to, const int *argcs, char ***argvs) {
+    int good = 0;
+    for (int i=from;i<to;i++) {
+        int rc = cl_parse_r(t->spec, r, argcs[i], argvs[i]);
+        if (rc == CL_OK && (t->spec->flags & CL_LAZY)) rc = cl_resolve(r);
+        if (rc == CL_OK) good++;
+        cl_table_put(t, ar, i, r, rc);
+    }
+    return good;
+}
+
+// parses n command lines into the table's columns, reusing its storage
+// across calls; returns the number of rows that parsed cleanly
+static int cl_parse_table(ClTable *t, int n, const int *argcs, char ***argvs) {
+    if (!t || !t->spec->indexed || t->count != t->spec->count || !cl_table_ok(t->spec)) return CL_ERR_SPEC;
+    if (cl_table_prepare(t, n, 1) != CL_OK) return CL_ERR_NOMEM;
+    ClResult *r = cl_result_new(t->spec);
+    if (!r) return CL_ERR_NOMEM;
+    int good = cl_table_fill(t, r, &t->arenas[0], 0, n, argcs, argvs);
+    cl_result_free(r);
+    return good;
+}
+
+static inline const ClValue *cl_table_column(const ClTable *t, int h) {
+    return (h >= 0 && h < t->count) ? &t->cols[(size_t)h * t->cap] : NULL;
+}
+
+static inline int cl_table_present(const ClTable *t, int h, int row) {
+    return h >= 0 && h < t->count && row >= 0 && row < t->rows && t->present[(size_t)h * t->cap + row];
+}
+
+#ifdef CLARGS_THREADS
+#include <pthread.h>
+
+typedef struct {
+    ClTable *t;
+    int worker, from, to, good;
+    const int *argcs;
+    char ***argvs;
+} ClTableJob;
+
+static void *cl_table_worker(void *arg) {
+    ClTableJob *j = (ClTableJob*)arg;
+    ClResult *r = cl_result_new(j->t->spec);
+    if (!r) { j->good = CL_ERR_NOMEM; return NULL; }
+    j->good = cl_table_fill(j->t, r, &j->t->arenas[j->worker], j->from, j->to, j->argcs, j->argvs);
+    cl_result_free(r);
     return NULL;
 }
 
+// cl_parse_table split across nthreads workers, each with its own result
+// and string arena writing a disjoint range of rows
+static int cl_parse_table_mt(ClTable *t, int n, const int *argcs, char ***argvs, int nthreads) {
+    if (nthreads <= 1 || n < nthreads) return cl_parse_table(t, n, argcs, argvs);
+    if (!t || !t->spec->indexed || t->count != t->spec->count || !cl_table_ok(t->spec)) return CL_ERR_SPEC;
+    if (cl_table_prepare(t, n, nthreads) != CL_OK) return CL_ERR_NOMEM;
+    ClTableJob *jobs = (ClTableJob*)calloc(nthreads, sizeof(ClTableJob));
+    pthread_t *tids = (pthread_t*)calloc(nthreads, sizeof(pthread_t));
+    if (!jobs || !tids) { free(jobs); free(tids); return CL_ERR_NOMEM; }
+    for (int k=0;k<nthreads;k++) {
+        jobs[k].t = t; jobs[k].worker = k;
+        jobs[k].from = (int)((long long)n * k / nthreads);
+        jobs[k].to = (int)((long long)n * (k + 1) / nthreads);
+        jobs[k].argcs = argcs; jobs[k].argvs = argvs;
+        if (k && pthread_create(&tids[k], NULL, cl_table_worker, &jobs[k]) != 0) cl_table_worker(&jobs[k]), tids[k] = 0;
+    }
+    cl_table_worker(&jobs[0]);
+    int good = 0;
+    for (int k=0;k<nthreads;k++) {
+        if (k && tids[k]) pthread_join(tids[k], NULL);
+        if (good >= 0) good = jobs[k].good < 0 ? jobs[k].good : good + jobs[k].good;
+    }
+    free(jobs);
+    free(tids);
+    return good;
+}
+#endif
+
+// result getters: h is the handle returned by cl_add_* or cl_handle
+
+static int cl_rget_flag(const ClResult *r, int h) { return h >= 0 && h < r->count && cl_bit(r->present, h); }
+static const char *cl_rget_string(const ClResult *r, int h) { return cl_ready(r, h) ? r->vals[h].str : NULL; }
+
+static char cl_rget_char(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0; } if (ok) *ok = 1; return r->vals[h].c; }
+static short cl_rget_short(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0; } if (ok) *ok = 1; return r->vals[h].s; }
+static int cl_rget_int(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0; } if (ok) *ok = 1; return r->vals[h].i; }
+static long cl_rget_long(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0L; } if (ok) *ok = 1; return r->vals[h].l; }
+static long long cl_rget_llong(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0LL; } if (ok) *ok = 1; return r->vals[h].ll; }
+
+static unsigned char cl_rget_uchar(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0; } if (ok) *ok = 1; return r->vals[h].uc; }
+static unsigned short cl_rget_ushort(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0; } if (ok) *ok = 1; return r->vals[h].us; }
+static unsigned int cl_rget_uint(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0u; } if (ok) *ok = 1; return r->vals[h].ui; }
+static unsigned long cl_rget_ulong(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0ul; } if (ok) *ok = 1; return r->vals[h].ul; }
+static unsigned long long cl_rget_ullong(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0ull; } if (ok) *ok = 1; return r->vals[h].ull; }
+
+static size_t cl_rget_size(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return (size_t)0; } if (ok) *ok = 1; return r->vals[h].sz; }
+
+static float cl_rget_float(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0.0f; } if (ok) *ok = 1; return r->vals[h].f; }
+static double cl_rget_double(const ClResult *r, int h, int *ok) { if (!cl_ready(r, h)) { if (ok) *ok = 0; return 0.0; } if (ok) *ok = 1; return r->vals[h].d; }
+
+// list getters: the values of a list argument in the order given, valid
+// until the result is parsed into again; *n receives the count
+static const void *cl_rget_list(const ClResult *r, int h, int *n) {
+    int ok = h >= 0 && h < r->nlists && r->lists[h].n;
+    if (n) *n = ok ? r->lists[h].n : 0;
+    return ok ? r->lists[h].data : NULL;
+}
+
+// typed list getters return NULL unless h is a list of that kind
+static const void *cl_rget_list_of(const ClResult *r, int h, int kind, int *n) {
+    int k = h >= 0 && h < r->count ? r->spec->args[h].kind : -1;
+    if (k == ARG_POSITIONAL) k = ARG_STRING;
+    if (k != kind) { if (n) *n = 0; return NULL; }
+    return cl_rget_list(r, h, n);
+}
+static const char *const *cl_rget_strings(const ClResult *r, int h, int *n) { return (const char *const *)cl_rget_list_of(r, h, ARG_STRING, n); }
+static const char *cl_rget_chars(const ClResult *r, int h, int *n) { return (const char*)cl_rget_list_of(r, h, ARG_CHAR, n); }
+static const short *cl_rget_shorts(const ClResult *r, int h, int *n) { return (const short*)cl_rget_list_of(r, h, ARG_SHORT, n); }
+static const int *cl_rget_ints(const ClResult *r, int h, int *n) { return (const int*)cl_rget_list_of(r, h, ARG_INT, n); }
+static const long *cl_rget_longs(const ClResult *r, int h, int *n) { return (const long*)cl_rget_list_of(r, h, ARG_LONG, n); }
+static const long long *cl_rget_llongs(const ClResult *r, int h, int *n) { return (const long long*)cl_rget_list_of(r, h, ARG_LLONG, n); }
+static const unsigned char *cl_rget_uchars(const ClResult *r, int h, int *n) { return (const unsigned char*)cl_rget_list_of(r, h, ARG_UCHAR, n); }
+static const unsigned short *cl_rget_ushorts(const ClResult *r, int h, int *n) { return (const unsigned short*)cl_rget_list_of(r, h, ARG_USHORT, n); }
+static const unsigned int *cl_rget_uints(const ClResult *r, int h, int *n) { return (const unsigned int*)cl_rget_list_of(r, h, ARG_UINT, n); }
+static const unsigned long *cl_rget_ulongs(const ClResult *r, int h, int *n) { return (const unsigned long*)cl_rget_list_of(r, h, ARG_ULONG, n); }
+static const unsigned long long *cl_rget_ullongs(const ClResult *r, int h, int *n) { return (const unsigned long long*)cl_rget_list_of(r, h, ARG_ULLONG, n); }
+static const size_t *cl_rget_sizes(const ClResult *r, int h, int *n) { return (const size_t*)cl_rget_list_of(r, h, ARG_SIZE, n); }
+static const float *cl_rget_floats(const ClResult *r, int h, int *n) { return (const float*)cl_rget_list_of(r, h, ARG_FLOAT, n); }
+static const double *cl_rget_doubles(const ClResult *r, int h, int *n) { return (const double*)cl_rget_list_of(r, h, ARG_DOUBLE, n); }
+
+// snapshots 
+
+// a parsed result flattened into one position-independent block: strings
+// and lists are stored as offsets from its start, so another process can
+// map it anywhere and read the values where they lie. Only a process with
+// the same spec and ABI (value size, long size, byte order) can read it
+typedef struct {
+    char magic[8];          // "CLARGSv1"
+    uint64_t spec;          // cl_spec_hash of the spec it was taken with
+    uint64_t size;          // bytes in the whole snapshot
+    uint32_t abi;
+    uint32_t count;         // handles
+    uint64_t kinds;         // offset of one byte per handle: ArgKind, | 0x80 for lists
+    uint64_t vals;          // offset of a ClValue per handle; strings hold offset + 1, 0 for NULL
+    uint64_t present;       // offset of the presence bitset
+    uint64_t lists;         // offset of a ClSnapList per handle, 0 if the spec has no lists
+} ClSnapHead;
+
+typedef struct {
+    uint64_t data;          // offset of the values, 8-aligned; strings as in vals
+    uint64_t n;
+} ClSnapList;
+
+// a snapshot opened for reading; every pointer points into it
+typedef struct {
+    const unsigned char *base;
+    size_t len;
+    int count;
+    const unsigned char *kinds;
+    const ClValue *vals;
+    const uint64_t *present;
+    const ClSnapList *lists;
+    int mapped;             // cl_snap_close unmaps it
+} ClSnap;
+
+// fingerprint of what decides a snapshot's layout and meaning: every
+// argument's kind, list flag and names, in handle order. It is computed
+// when the spec is frozen, so p must be
+static inline uint64_t cl_spec_hash(const Clargs *p) {
+    return p->fingerprint;
+}
+
+static inline uint32_t cl_snap_abi(void) {
+    const uint16_t one = 1;
+    return (uint32_t)sizeof(ClValue) | (uint32_t)sizeof(long) << 8 | (uint32_t)sizeof(void*) << 16 | (uint32_t)*(const unsigned char*)&one << 24;
+}
+
+static inline size_t cl_snap_align(ClBuf *b) {
+    cl_buf_pad(b, 0, (int)((8 - (b->n & 7)) & 7));
+    return b->n;
+}
+
+// appends s with its NUL and returns its offset + 1, or 0 for NULL
+static inline uint64_t cl_snap_str(ClBuf *b, const char *s) {
+    if (!s) return 0;
+    size_t at = b->n;
+    cl_buf_put(b, s, strlen(s) + 1);
+    return (uint64_t)at + 1;
+}
+
+// flattens r into one malloc'd block of *len bytes, converting pending
+// CL_LAZY values first; NULL if one of them is malformed or memory runs out
+static void *cl_snapshot(const ClResult *r, size_t *len) {
+    const Clargs *p = r->spec;
+    int lists = 0;
+    for (int h=0;h<r->count;h++) {
+        if (!cl_ready(r, h)) return NULL;
+        if (p->args[h].multi) lists = 1;
+    }
+    ClSnapHead hd;
+    memset(&hd, 0, sizeof hd);
+    memcpy(hd.magic, "CLARGSv1", 8);
+    hd.spec = cl_spec_hash(p);
+    hd.abi = cl_snap_abi();
+    hd.count = (uint32_t)r->count;
+    hd.kinds = sizeof hd;
+    hd.vals = (hd.kinds + r->count + 7) & ~(uint64_t)7;
+    hd.present = hd.vals + r->count * sizeof(ClValue);
+    hd.lists = lists ? hd.present + CL_WORDS(r->count) * sizeof(uint64_t) : 0;
+    ClBuf b;
+    memset(&b, 0, sizeof b);
+    cl_buf_pad(&b, 0, (int)(lists ? hd.lists + r->count * sizeof(ClSnapList) : hd.present + CL_WORDS(r->count) * sizeof(uint64_t)));
+    for (int h=0;h<r->count && !b.err;h++) {
+        const Clarg *a = &p->args[h];
+        ClValue v = r->vals[h];
+        b.s[hd.kinds + h] = (char)(a->kind | (a->multi ? 0x80 : 0));
+        if (cl_is_str(a)) { uint64_t off = a->multi ? 0 : cl_snap_str(&b, v.str); memset(&v, 0, sizeof v); v.ull = off; }
+        if (b.err) break;
+        memcpy(b.s + hd.vals + h * sizeof(ClValue), &v, sizeof v);
+        if (!a->multi) continue;
+        ClSnapList l = { 0, 0 };
+        int n;
+        const void *data = cl_rget_list(r, h, &n);
+        if (data && n > 0) {
+            l.data = cl_snap_align(&b);
+            l.n = (uint64_t)n;
+            if (!cl_is_str(a)) cl_buf_put(&b, (const char*)data, (size_t)n * cl_kind_size[a->kind]);
+            else {
+                cl_buf_pad(&b, 0, n * (int)sizeof(uint64_t));
+                for (int i=0;i<n && !b.err;i++) {
+                    uint64_t off = cl_snap_str(&b, ((const char *const*)data)[i]);
+                    if (!b.err) memcpy(b.s + l.data + i * sizeof(uint64_t), &off, sizeof off);
+                }
+            }
+        }
+        if (!b.err) memcpy(b.s + hd.lists + h * sizeof(ClSnapList), &l, sizeof l);
+    }
+    cl_snap_align(&b);
+    if (b.err) { free(b.s); return NULL; }
+    memcpy(b.s + hd.present, r->present, CL_WORDS(r->count) * sizeof(uint64_t));
+    hd.size = b.n;
+    memcpy(b.s, &hd, sizeof hd);
+    *len = b.n;
+    return b.s;
+}
+
+// cl_snapshot written to an anonymous file (a memfd on Linux) and rewound
+// to its start; the descriptor stays open across fork and exec so a worker
+// can cl_snap_map it. Returns the descriptor, or -1
+static int cl_snapshot_fd(const ClResult *r) {
+#ifdef CL_HAVE_UNISTD
+    size_t len, done = 0;
+    char *s = (char*)cl_snapshot(r, &len);
+    if (!s) return -1;
+    int fd = -1;
+#if defined(__linux__) && defined(SYS_memfd_create) && (defined(_DEFAULT_SOURCE) || defined(_GNU_SOURCE))
+    fd = (int)syscall(SYS_memfd_create, "clargs-snapshot", 0);
+#endif
+#ifdef CL_HAVE_MKSTEMP
+    if (fd < 0) {
+        char path[] = "/tmp/clargs-snapshot-XXXXXX";
+        fd = mkstemp(path);
+        if (fd >= 0) unlink(path);
+    }
+#endif
+    while (fd >= 0 && done < len) {
+        ssize_t n = write(fd, s + done, len - done);
+        if (n <= 0) { close(fd); fd = -1; }
+        else done += (size_t)n;
+    }
+    free(s);
+    if (fd >= 0 && lseek(fd, 0, SEEK_SET) != 0) { close(fd); fd = -1; }
+    return fd;
+#else
+    (void)r;
+    return -1;
+#endif
+}
+
+// whether the string at offset + 1 off ends inside the snapshot
+static inline int cl_snap_str_ok(const unsigned char *base, uint64_t size, uint64_t off) {
+    return !off || (off - 1 < size && memchr(base + off - 1, 0, (size_t)(size - off + 1)));
+}
+
+// checks a snapshot in memory and points s into it; nothing is copied and
+// data must stay valid while s is used. spec is the cl_spec_hash the reader
+// expects. Returns CL_OK, CL_ERR_SPEC if it was taken with another spec or
+// ABI, or CL_ERR_SNAPSHOT if it is truncated or malformed
+static int cl_snap_open(ClSnap *s, uint64_t spec, const void *data, size_t len) {
+    const unsigned char *base = (const unsigned char*)data;
+    const ClSnapHead *hd = (const ClSnapHead*)data;
+    memset(s, 0, sizeof *s);
+    if (!data || len < sizeof *hd || ((uintptr_t)data & 7) || memcmp(hd->magic, "CLARGSv1", 8)) return CL_ERR_SNAPSHOT;
+    if (hd->abi != cl_snap_abi() || hd->spec != spec) return CL_ERR_SPEC;
+    uint64_t n = hd->count, size = hd->size, words = CL_WORDS(n) * sizeof(uint64_t);
+    if (size > len || hd->kinds != sizeof *hd || hd->vals != ((hd->kinds + n + 7) & ~(uint64_t)7) || hd->present != hd->vals + n * sizeof(ClValue)
+        || hd->present + words > size || (hd->lists && (hd->lists != hd->present + words || hd->lists + n * sizeof(ClSnapList) > size)))
+        return CL_ERR_SNAPSHOT;
+    const ClValue *vals = (const ClValue*)(base + hd->vals);
+    const ClSnapList *lists = hd->lists ? (const ClSnapList*)(base + hd->lists) : NULL;
+    // every string and list must lie inside the snapshot
+    for (uint64_t h=0;h<n;h++) {
+        int kind = base[hd->kinds + h] & 0x7f, multi = base[hd->kinds + h] >> 7, str = kind == ARG_STRING || kind == ARG_POSITIONAL;
+        if (kind > ARG_POSITIONAL || (multi && !lists)) return CL_ERR_SNAPSHOT;
+        if (!multi) { if (str && !cl_snap_str_ok(base, size, vals[h].ull)) return CL_ERR_SNAPSHOT; continue; }
+        const ClSnapList *l = &lists[h];
+        size_t w = str ? sizeof(uint64_t) : cl_kind_size[kind];
+        if (l->n > INT_MAX || (l->n && ((l->data & 7) || l->data > size || l->n > (size - l->data) / w))) return CL_ERR_SNAPSHOT;
+        for (uint64_t i=0;str && i<l->n;i++)
+            if (!cl_snap_str_ok(base, size, ((const uint64_t*)(base + l->data))[i])) return CL_ERR_SNAPSHOT;
+    }
+    s->base = base;
+    s->len = (size_t)size;
+    s->count = (int)n;
+    s->kinds = base + hd->kinds;
+    s->vals = vals;
+    s->present = (const uint64_t*)(base + hd->present);
+    s->lists = lists;
+    return CL_OK;
+}
+
+// maps the snapshot in fd read-only and opens it; the descriptor may be
+// closed afterwards. Release it with cl_snap_close
+static int cl_snap_map(ClSnap *s, uint64_t spec, int fd) {
+    memset(s, 0, sizeof *s);
+#ifdef CL_HAVE_MMAP
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ClSnapHead)) return CL_ERR_SNAPSHOT;
+    size_t len = (size_t)st.st_size;
+    void *addr = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) return CL_ERR_SNAPSHOT;
+    int rc = cl_snap_open(s, spec, addr, len);
+    if (rc != CL_OK) { munmap(addr, len); return rc; }
+    s->len = len;
+    s->mapped = 1;
+    return CL_OK;
+#else
+    (void)spec; (void)fd;
+    return CL_ERR_SNAPSHOT;
+#endif
+}
+
+static void cl_snap_close(ClSnap *s) {
+#ifdef CL_HAVE_MMAP
+    if (s->mapped) munmap((void*)s->base, s->len);
+#endif
+    memset(s, 0, sizeof *s);
+}
+
+// snapshot getters: h is a handle of the spec the snapshot was taken with
+static inline int cl_snap_kind(const ClSnap *s, int h) {
+    return h >= 0 && h < s->count ? s->kinds[h] : -1;
+}
+
+static int cl_snap_flag(const ClSnap *s, int h) {
+    return h >= 0 && h < s->count && cl_bit(s->present, h);
+}
+
+// the value slot of a scalar option, read through the member for its
+// kind; NULL for strings and lists
+static const ClValue *cl_snap_value(const ClSnap *s, int h) {
+    int k = cl_snap_kind(s, h);
+    return k >= 0 && k != ARG_STRING && k != ARG_POSITIONAL && k < 0x80 ? &s->vals[h] : NULL;
+}
+
+static const char *cl_snap_string(const ClSnap *s, int h) {
+    int k = cl_snap_kind(s, h);
+    uint64_t off = k == ARG_STRING || k == ARG_POSITIONAL ? s->vals[h].ull : 0;
+    return off ? (const char*)s->base + off - 1 : NULL;
+}
+
+// the values of a list that is not of strings, in place
+static const void *cl_snap_list(const ClSnap *s, int h, int *n) {
+    int k = cl_snap_kind(s, h);
+    if (n) *n = 0;
+    if (k < 0x80 || k == (0x80 | ARG_STRING) || k == (0x80 | ARG_POSITIONAL) || !s->lists[h].n) return NULL;
+    if (n) *n = (int)s->lists[h].n;
+    return s->base + s->lists[h].data;
+}
+
+// element i of a list of strings
+static const char *cl_snap_list_string(const ClSnap *s, int h, int i) {
+    int k = cl_snap_kind(s, h);
+    if ((k != (0x80 | ARG_STRING) && k != (0x80 | ARG_POSITIONAL)) || i < 0 || (uint64_t)i >= s->lists[h].n) return NULL;
+    uint64_t off = ((const uint64_t*)(s->base + s->lists[h].data))[i];
+    return off ? (const char*)s->base + off - 1 : NULL;
+}
+
+// layered sources 
+
+#ifdef CL_HAVE_UNISTD
+#ifdef __cplusplus
+extern "C" char **environ;
+#else
+extern char **environ;
+#endif
+#endif
+
+// sets where cl_parse_layers (and cl_parse) look for what argv leaves out:
+// variables named env_prefix + "_" + the long name upper-cased with '-' as
+// '_', then a config file, then the defaults. Either may be NULL. cache,
+// if not NULL, is a file kept with a snapshot of the config file's values
+// so later starts skip reading its text. The strings are not copied
+static void cl_sources(Clargs *p, const char *env_prefix, const char *config, const char *cache) {
+    if (!p) return;
+    p->env_prefix = env_prefix;
+    p->config = config;
+    p->config_cache = config ? cache : NULL;
+}
+
+// where the value of h came from
+static int cl_source(const ClResult *r, int h) {
+    if (h < 0 || h >= r->count) return CL_SRC_DEFAULT;
+    if (r->layer && cl_bit(r->layer, h)) return CL_SRC_ENV;
+    if (r->layer && cl_bit(r->layer + r->nlayer, h)) return CL_SRC_CONFIG;
+    return cl_bit(r->present, h) ? CL_SRC_ARGV : CL_SRC_DEFAULT;
+}
+
+static const char *cl_source_name(int src) {
+    static const char *const names[] = { "argv", "env", "config", "default" };
+    return src >= CL_SRC_ARGV && src <= CL_SRC_DEFAULT ? names[src] : "?";
+}
+
+static int cl_layer_alloc(ClResult *r) {
+    int words = CL_WORDS(r->count);
+    if (!r->layer || r->nlayer != words) {
+        uint64_t *l = (uint64_t*)realloc(r->layer, 2 * (words ? words : 1) * sizeof(uint64_t));
+        if (!l) return 0;
+        r->layer = l;
+        r->nlayer = words;
+    }
+    memset(r->layer, 0, 2 * r->nlayer * sizeof(uint64_t));
+    return 1;
+}
+
+static int cl_layer_fail(ClResult *r, int src, int code, int line, int h, const char *key) {
+    r->err_src = src;
+    r->err_text = key;
+    return cl_fail(r, code, line, 0, h);
+}
+
+// 1 for true/yes/on/1, 0 for false/no/off/0 or nothing, -1 otherwise
+static int cl_bool(const char *s) {
+    static const char *const words[] = { "0", "false", "no", "off", "1", "true", "yes", "on" };
+    if (!*s) return 0;
+    for (int i=0;i<8;i++) {
+        const char *w = words[i], *c = s;
+        while (*w && (*c | 32) == *w) { c++; w++; }
+        if (!*w && !*c) return i >= 4;
+    }
+    return -1;
+}
+
+// stores a value from the environment or the config file, converted at
+// once even under CL_LAZY; a flag takes a boolean and may be cleared
+static int cl_layer_set(ClResult *r, int h, const char *val) {
+    if (r->spec->args[h].kind == ARG_FLAG) {
+        int on = cl_bool(val);
+        if (on < 0) return 0;
+        if (on) cl_bit_set(r->present, h);
+        else cl_bit_clr(r->present, h);
+        return 1;
+    }
+    cl_bit_set(r->present, h);
+    CL_CLOCK(t);
+    int ok = cl_convert(r, h, val);
+    CL_LAP(r, CL_PHASE_CONVERT, t);
+    return ok;
+}
+
+static int cl_layer_var(const Clargs *p, ClResult *r, int h, const char *val) {
+    if (h < 0 || p->args[h].kind == ARG_POSITIONAL || cl_source(r, h) != CL_SRC_DEFAULT) return CL_OK;
+    if (!cl_layer_set(r, h, val)) return cl_layer_fail(r, CL_SRC_ENV, cl_is_str(&p->args[h]) ? CL_ERR_NOMEM : CL_ERR_BAD_VALUE, 0, h, NULL);
+    cl_bit_set(r->layer, h);
+    return CL_OK;
+}
+
+// the environment layer: each PREFIX_NAME variable is looked up as a long
+// option name, lower-cased with '_' read as '-' and then as itself
+static int cl_layer_env(const Clargs *p, ClResult *r) {
+#ifdef CL_HAVE_UNISTD
+    size_t pn = strlen(p->env_prefix);
+    char name[256];
+    for (char **e = environ; e && *e; e++) {
+        const char *s = *e, *eq = strchr(s, '=');
+        if (!eq || strncmp(s, p->env_prefix, pn) || s[pn] != '_') continue;
+        s += pn + 1;
+        size_t n = (size_t)(eq - s);
+        if (!n || n >= sizeof name) continue;
+        int dash = 0;
+        for (size_t i=0;i<n;i++) {
+            char c = s[i] >= 'A' && s[i] <= 'Z' ? (char)(s[i] + 32) : s[i];
+            if (c == '_') { c = '-'; dash = 1; }
+            name[i] = c;
+        }
+        int h = cl_parse_lookup(p, r, name, n, 0);
+        if (h < 0 && dash) {
+            for (size_t i=0;i<n;i++) if (name[i] == '-') name[i] = '_';
+            h = cl_parse_lookup(p, r, name, n, 0);
+        }
+        int rc = cl_layer_var(p, r, h, eq + 1);
+        if (rc != CL_OK) return rc;
+    }
+#else
+    char var[256];
+    for (int h=0;h<p->count;h++) {
+        if (!p->args[h].long_name) continue;
+        cl_env_name(p, h, var, sizeof var);
+        const char *val = getenv(var);
+        int rc = val ? cl_layer_var(p, r, h, val) : CL_OK;
+        if (rc != CL_OK) return rc;
+    }
+#endif
+    return CL_OK;
+}
+
+// NUL-terminates [s, e) in place, or copies it out when it runs to the end
+// of the mapping and there is no byte left for the NUL
+static char *cl_layer_cut(ClResult *r, char *s, char *e, const char *end) {
+    if (e < end) { *e = 0; return s; }
+    char *d = (char*)cl_arena_alloc(&r->arena, (size_t)(e - s) + 1);
+    if (!d) return NULL;
+    memcpy(d, s, (size_t)(e - s));
+    d[e - s] = 0;
+    return d;
+}
+
+// the config file layer: "name = value" lines, mapped and split in place
+// so string values point into the mapping. Blank lines and lines starting
+// with # or ; are skipped; the name may keep its leading "--". A value may
+// be quoted, and an unquoted one ends at a '#' that follows whitespace. A
+// name alone turns a flag on, and a list takes one value per line it is
+// on. A missing file is an empty one
+static int cl_layer_file(const Clargs *p, ClResult *r, const char *path) {
+    size_t len;
+    errno = 0;
+    char *s = cl_map_file(r, path, &len);
+    if (!s) return errno == ENOENT ? CL_OK : cl_layer_fail(r, CL_SRC_CONFIG, errno == ENOMEM ? CL_ERR_NOMEM : CL_ERR_CONFIG, 0, -1, NULL);
+    char *end = s + len;
+    for (int line=1;s < end;line++) {
+        char *eol = (char*)memchr(s, '\n', (size_t)(end - s));
+        if (!eol) eol = end;
+        char *k = s, *v = NULL, *ve = eol;
+        s = eol < end ? eol + 1 : end;
+        while (k < eol && cl_isspace(*k)) k++;
+        if (k == eol || *k == '#' || *k == ';') continue;
+        char *ke = (char*)memchr(k, '=', (size_t)(eol - k));
+        if (ke) v = ke + 1;
+        else ke = eol;
+        while (ke > k && cl_isspace(ke[-1])) ke--;
+        if (ke - k > 2 && k[0] == '-' && k[1] == '-') k += 2;
+        if (ke == k) return cl_layer_fail(r, CL_SRC_CONFIG, CL_ERR_CONFIG, line, -1, NULL);
+        if (v) {
+            while (v < eol && cl_isspace(*v)) v++;
+            if (v < eol && (*v == '"' || *v == '\'')) {
+                char *q = (char*)memchr(v + 1, *v, (size_t)(eol - v - 1));
+                char *c = q ? q + 1 : eol;
+                while (c < eol && cl_isspace(*c)) c++;
+                if (!q || (c < eol && *c != '#')) return cl_layer_fail(r, CL_SRC_CONFIG, CL_ERR_CONFIG, line, -1, NULL);
+                v++;
+                ve = q;
+            } else {
+                for (ve = v; ve < eol && !(*ve == '#' && ve > v && cl_isspace(ve[-1])); ve++) {}
+                while (ve > v && cl_isspace(ve[-1])) ve--;
+            }
+        }
+        char *key = cl_layer_cut(r, k, ke, end);
+        if (!key) return cl_layer_fail(r, CL_SRC_CONFIG, CL_ERR_NOMEM, line, -1, NULL);
+        int h = cl_parse_lookup(p, r, key, (size_t)(ke - k), 0);
+        if (h < 0 || p->args[h].kind == ARG_POSITIONAL) return cl_layer_fail(r, CL_SRC_CONFIG, CL_ERR_UNKNOWN, line, -1, key);
+        int src = cl_source(r, h);
+        if (src != CL_SRC_DEFAULT && src != CL_SRC_CONFIG) continue;
+        if (!v && p->args[h].kind != ARG_FLAG) return cl_layer_fail(r, CL_SRC_CONFIG, CL_ERR_MISSING_VALUE, line, h, key);
+        const char *val = v ? cl_layer_cut(r, v, ve, end) : "1";
+        if (!val) return cl_layer_fail(r, CL_SRC_CONFIG, CL_ERR_NOMEM, line, h, key);
+        if (!cl_layer_set(r, h, val))
+            return cl_layer_fail(r, CL_SRC_CONFIG, cl_is_str(&p->args[h]) ? CL_ERR_NOMEM : CL_ERR_BAD_VALUE, line, h, key);
+        cl_bit_set(r->layer + r->nlayer, h);
+    }
+    return CL_OK;
+}
+
+#ifdef CL_HAVE_MMAP
+// a config cache file: this header, the config layer's bitset (which
+// options the file set, including flags it set to false), then a snapshot
+// of a result that holds only the config file's values. It is used while
+// the file still has the identity, size and modification time recorded here
+typedef struct {
+    char magic[8];          // "CLARGScc"
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime;
+    int64_t mtime_ns;
+} ClCacheHead;
+
+static int cl_cache_key(const char *path, ClCacheHead *key) {
+    struct stat st;
+    memset(key, 0, sizeof *key);
+    if (stat(path, &st) != 0) return 0;
+    memcpy(key->magic, "CLARGScc", 8);
+    key->ino = (uint64_t)st.st_ino;
+    key->size = (uint64_t)st.st_size;
+    key->mtime = (int64_t)st.st_mtime;
+    // st_mtim is POSIX.1-2008; strict ISO modes only have whole seconds
+#if defined(__APPLE__)
+    key->mtime_ns = (int64_t)st.st_mtimespec.tv_nsec;
+#elif defined(__linux__) && ((defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L) || defined(_DEFAULT_SOURCE) || defined(_GNU_SOURCE))
+    key->mtime_ns = (int64_t)st.st_mtim.tv_nsec;
+#endif
+    return 1;
+}
+
+// fills what argv and the environment left out from a current cache, in
+// place: strings stay in the mapping, which r keeps until its next parse.
+// Returns 0 if the cache is missing, stale or of another spec
+static int cl_cache_load(const Clargs *p, ClResult *r, const ClCacheHead *key) {
+    size_t len, head = sizeof *key + (size_t)r->nlayer * sizeof(uint64_t);
+    char *s = cl_map_file(r, p->config_cache, &len);
+    ClSnap sn;
+    if (!s || !len) return 0;
+    if (len < head || memcmp(s, key, sizeof *key) || cl_snap_open(&sn, cl_spec_hash(p), s + head, len - head) != CL_OK || sn.count != r->count) {
+        munmap(s, len);
+        r->nmaps--;
+        return 0;
+    }
+    const uint64_t *set = (const uint64_t*)(s + sizeof *key);
+    for (int h=0;h<sn.count;h++) {
+        const Clarg *a = &p->args[h];
+        if (!cl_bit(set, h) || cl_source(r, h) != CL_SRC_DEFAULT) continue;
+        cl_bit_set(r->layer + r->nlayer, h);
+        if (!cl_snap_flag(&sn, h)) continue;    // a flag the file turned off
+        if (a->multi && cl_is_str(a)) {
+            const char *e;
+            for (int i=0;(e = cl_snap_list_string(&sn, h, i));i++)
+                if (!cl_list_add_str(r, h, e, strlen(e), 1)) return -1;
+        } else if (a->multi) {
+            int n;
+            const void *d = cl_snap_list(&sn, h, &n);
+            void *slot = cl_list_reserve(r, h, n);
+            if (!slot) return -1;
+            memcpy(slot, d, (size_t)n * cl_kind_size[a->kind]);
+            r->lists[h].n += n;
+        } else if (cl_is_str(a)) {
+            r->vals[h].str = cl_snap_string(&sn, h);
+        } else if (a->kind != ARG_FLAG) {
+            r->vals[h] = *cl_snap_value(&sn, h);
+        }
+        cl_bit_set(r->present, h);
+    }
+    return 1;
+}
+
+// reads the config file into a result of its own and writes its snapshot
+// next to the cache path, then renames it over the cache. Nothing is
+// written if the file has errors or changes while it is read
+static void cl_cache_build(const Clargs *p, const ClCacheHead *key) {
+#ifdef CL_HAVE_MKSTEMP
+    ClResult *c = cl_result_new(p);
+    ClCacheHead now;
+    size_t len = 0, n = strlen(p->config_cache);
+    void *snap = NULL;
+    if (c && cl_layer_alloc(c) && cl_layer_file(p, c, p->config) == CL_OK) snap = cl_snapshot(c, &len);
+    char *tmp = snap ? (char*)malloc(n + 8) : NULL;
+    if (tmp && cl_cache_key(p->config, &now) && !memcmp(&now, key, sizeof now)) {
+        memcpy(tmp, p->config_cache, n);
+        memcpy(tmp + n, ".XXXXXX", 8);
+        int fd = mkstemp(tmp);
+        if (fd >= 0) {
+            size_t bits = (size_t)c->nlayer * sizeof(uint64_t);
+            int ok = write(fd, key, sizeof *key) == (ssize_t)sizeof *key && write(fd, c->layer + c->nlayer, bits) == (ssize_t)bits && write(fd, snap, len) == (ssize_t)len;
+            ok = close(fd) == 0 && ok;
+            if (!ok || rename(tmp, p->config_cache) != 0) unlink(tmp);
+        }
+    }
+    free(tmp);
+    free(snap);
+    cl_result_free(c);
+#else
+    (void)p; (void)key;
+#endif
+}
+#endif
+
+// the config layer, from the cache when it is current
+static int cl_layer_config(const Clargs *p, ClResult *r) {
+#ifdef CL_HAVE_MMAP
+    ClCacheHead key;
+    if (p->config_cache && cl_cache_key(p->config, &key)) {
+        int rc = cl_cache_load(p, r, &key);
+        if (!rc) {
+            cl_cache_build(p, &key);
+            rc = cl_cache_load(p, r, &key);
+        }
+        if (rc < 0) return cl_layer_fail(r, CL_SRC_CONFIG, CL_ERR_NOMEM, 0, -1, NULL);
+        if (rc) return CL_OK;
+    }
+#endif
+    return cl_layer_file(p, r, p->config);
+}
+
+// cl_parse_r, then the environment and the config file of cl_sources fill
+// what argv left out, and the required arguments and rules are checked
+// against the merged values. Without sources it is cl_parse_r
+static int cl_parse_layers(const Clargs *p, ClResult *r, int argc, char **argv) {
+    int rc = cl_parse_r(p, r, argc, argv);
+    if (!p || !r || (!p->env_prefix && !p->config)) return rc;
+    if (rc != CL_OK && rc != CL_ERR_REQUIRED && rc != CL_ERR_CONSTRAINT) return rc;
+    cl_fail(r, CL_OK, 0, 0, -1);
+    r->err_rule = -1;
+    if (!cl_layer_alloc(r)) return cl_fail(r, CL_ERR_NOMEM, 0, 0, -1);
+    if (p->env_prefix && (rc = cl_layer_env(p, r)) != CL_OK) return rc;
+    if (p->config && (rc = cl_layer_config(p, r)) != CL_OK) return rc;
+    return cl_validate(p, r);
+}
+
+// one value as a config file value: numbers exact, strings quoted when
+// they would not read back as they are
+static void cl_buf_value(ClBuf *b, int kind, const void *v) {
+    switch (kind) {
+        case ARG_STRING: case ARG_POSITIONAL: {
+            const char *s = *(const char *const*)v;
+            size_t n = strlen(s);
+            int quote = !n || cl_isspace(s[0]) || cl_isspace(s[n - 1]) || s[0] == '"' || s[0] == '\'';
+            for (size_t i=1;i<n && !quote;i++) quote = s[i] == '#' && cl_isspace(s[i - 1]);
+            char q = strchr(s, '"') ? '\'' : '"';
+            if (quote) cl_buf_put(b, &q, 1);
+            cl_buf_put(b, s, n);
+            if (quote) cl_buf_put(b, &q, 1);
+            break;
+        }
+        case ARG_CHAR: cl_buf_put(b, (const char*)v, 1); break;
+        case ARG_SHORT: cl_buf_fmt(b, "%d", *(const short*)v); break;
+        case ARG_INT: cl_buf_fmt(b, "%d", *(const int*)v); break;
+        case ARG_LONG: cl_buf_fmt(b, "%ld", *(const long*)v); break;
+        case ARG_LLONG: cl_buf_fmt(b, "%lld", *(const long long*)v); break;
+        case ARG_UCHAR: cl_buf_fmt(b, "%u", (unsigned)*(const unsigned char*)v); break;
+        case ARG_USHORT: cl_buf_fmt(b, "%u", (unsigned)*(const unsigned short*)v); break;
+        case ARG_UINT: cl_buf_fmt(b, "%u", *(const unsigned*)v); break;
+        case ARG_ULONG: cl_buf_fmt(b, "%lu", *(const unsigned long*)v); break;
+        case ARG_ULLONG: cl_buf_fmt(b, "%llu", *(const unsigned long long*)v); break;
+        case ARG_SIZE: cl_buf_fmt(b, "%zu", *(const size_t*)v); break;
+        case ARG_FLOAT: cl_buf_fmt(b, "%.9g", (double)*(const float*)v); break;
+        case ARG_DOUBLE: cl_buf_fmt(b, "%.17g", *(const double*)v); break;
+        default: break;
+    }
+}
+
+static void cl_buf_source(ClBuf *b, const Clargs *p, const ClResult *r, int h) {
+    char var[256];
+    int src = cl_source(r, h);
+    cl_buf_fmt(b, "  # %s", cl_source_name(src));
+    if (src == CL_SRC_ENV) { cl_env_name(p, h, var, sizeof var); cl_buf_fmt(b, " %s", var); }
+    if (src == CL_SRC_CONFIG) cl_buf_fmt(b, " %s", p->config);
+    cl_buf_put(b, "\n", 1);
+}
+
+// writes every option that has a long name to stdout as a config file
+// line, followed by where its value came from:
+//   port = 8080  # env APP_PORT
+// A list gets one line per value; an option with no value is commented out
+static void cl_print_config(const Clargs *p, const ClResult *r) {
+    ClBuf b;
+    memset(&b, 0, sizeof b);
+    for (int h=0;h<r->count;h++) {
+        const Clarg *a = &p->args[h];
+        if (!a->long_name || a->kind == ARG_POSITIONAL || !cl_ready(r, h)) continue;
+        if (a->kind == ARG_FLAG) {
+            cl_buf_fmt(&b, "%s = %s", a->long_name, cl_bit(r->present, h) ? "true" : "false");
+            cl_buf_source(&b, p, r, h);
+            continue;
+        }
+        int n = 1;
+        const char *data = (const char*)(a->multi ? cl_rget_list(r, h, &n) : &r->vals[h]);
+        if (!data || !n || (cl_is_str(a) && !*(const char *const*)data)) {
+            cl_buf_fmt(&b, "# %s =", a->long_name);
+            cl_buf_source(&b, p, r, h);
+            continue;
+        }
+        for (int i=0;i<n;i++) {
+            cl_buf_fmt(&b, "%s = ", a->long_name);
+            cl_buf_value(&b, a->kind, data + (size_t)i * (a->multi ? cl_kind_size[a->kind] : 0));
+            cl_buf_source(&b, p, r, h);
+        }
+    }
+    if (!b.err) cl_write_out(b.s, b.n);
+    free(b.s);
+}
+
+// finder and getters
+
+static Clarg *cl_find(Clargs *p, const char *name) {
+    int i = cl_find_idx(p, name);
+    return i < 0 ? NULL : &p->args[i];
+}
+
 static int cl_get_flag(Clargs *p, const char *name) {
-    Clarg *a = cl_find(p, name); return a && a->present;
+    return cl_rget_flag(&p->res, cl_find_idx(p, name));
 }
 
 static const char *cl_get_string(Clargs *p, const char *name) {
-    Clarg *a = cl_find(p, name); return a ? a->val_str : NULL;
+    return cl_rget_string(&p->res, cl_find_idx(p, name));
 }
 
-static char cl_get_char(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0; } if (ok) *ok = 1; return a->val_char; }
-static short cl_get_short(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0; } if (ok) *ok = 1; return a->val_short; }
-static int cl_get_int(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0; } if (ok) *ok = 1; return a->val_int; }
-static long cl_get_long(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0L; } if (ok) *ok = 1; return a->val_long; }
-static long long cl_get_llong(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0LL; } if (ok) *ok = 1; return a->val_llong; }
+static char cl_get_char(Clargs *p, const char *name, int *ok) { return cl_rget_char(&p->res, cl_find_idx(p, name), ok); }
+static short cl_get_short(Clargs *p, const char *name, int *ok) { return cl_rget_short(&p->res, cl_find_idx(p, name), ok); }
+static int cl_get_int(Clargs *p, const char *name, int *ok) { return cl_rget_int(&p->res, cl_find_idx(p, name), ok); }
+static long cl_get_long(Clargs *p, const char *name, int *ok) { return cl_rget_long(&p->res, cl_find_idx(p, name), ok); }
+static long long cl_get_llong(Clargs *p, const char *name, int *ok) { return cl_rget_llong(&p->res, cl_find_idx(p, name), ok); }
+
+static unsigned char cl_get_uchar(Clargs *p, const char *name, int *ok) { return cl_rget_uchar(&p->res, cl_find_idx(p, name), ok); }
+static unsigned short cl_get_ushort(Clargs *p, const char *name, int *ok) { return cl_rget_ushort(&p->res, cl_find_idx(p, name), ok); }
+static unsigned int cl_get_uint(Clargs *p, const char *name, int *ok) { return cl_rget_uint(&p->res, cl_find_idx(p, name), ok); }
+static unsigned long cl_get_ulong(Clargs *p, const char *name, int *ok) { return cl_rget_ulong(&p->res, cl_find_idx(p, name), ok); }
+static unsigned long long cl_get_ullong(Clargs *p, const char *name, int *ok) { return cl_rget_ullong(&p->res, cl_find_idx(p, name), ok); }
+
+static size_t cl_get_size(Clargs *p, const char *name, int *ok) { return cl_rget_size(&p->res, cl_find_idx(p, name), ok); }
+
+static float cl_get_float(Clargs *p, const char *name, int *ok) { return cl_rget_float(&p->res, cl_find_idx(p, name), ok); }
+static double cl_get_double(Clargs *p, const char *name, int *ok) { return cl_rget_double(&p->res, cl_find_idx(p, name), ok); }
+
+static const char *const *cl_get_strings(Clargs *p, const char *name, int *n) { return cl_rget_strings(&p->res, cl_find_idx(p, name), n); }
+static const char *cl_get_chars(Clargs *p, const char *name, int *n) { return cl_rget_chars(&p->res, cl_find_idx(p, name), n); }
+static const short *cl_get_shorts(Clargs *p, const char *name, int *n) { return cl_rget_shorts(&p->res, cl_find_idx(p, name), n); }
+static const int *cl_get_ints(Clargs *p, const char *name, int *n) { return cl_rget_ints(&p->res, cl_find_idx(p, name), n); }
+static const long *cl_get_longs(Clargs *p, const char *name, int *n) { return cl_rget_longs(&p->res, cl_find_idx(p, name), n); }
+static const long long *cl_get_llongs(Clargs *p, const char *name, int *n) { return cl_rget_llongs(&p->res, cl_find_idx(p, name), n); }
+static const unsigned char *cl_get_uchars(Clargs *p, const char *name, int *n) { return cl_rget_uchars(&p->res, cl_find_idx(p, name), n); }
+static const unsigned short *cl_get_ushorts(Clargs *p, const char *name, int *n) { return cl_rget_ushorts(&p->res, cl_find_idx(p, name), n); }
+static const unsigned int *cl_get_uints(Clargs *p, const char *name, int *n) { return cl_rget_uints(&p->res, cl_find_idx(p, name), n); }
+static const unsigned long *cl_get_ulongs(Clargs *p, const char *name, int *n) { return cl_rget_ulongs(&p->res, cl_find_idx(p, name), n); }
+static const unsigned long long *cl_get_ullongs(Clargs *p, const char *name, int *n) { return cl_rget_ullongs(&p->res, cl_find_idx(p, name), n); }
+static const size_t *cl_get_sizes(Clargs *p, const char *name, int *n) { return cl_rget_sizes(&p->res, cl_find_idx(p, name), n); }
+static const float *cl_get_floats(Clargs *p, const char *name, int *n) { return cl_rget_floats(&p->res, cl_find_idx(p, name), n); }
+static const double *cl_get_doubles(Clargs *p, const char *name, int *n) { return cl_rget_doubles(&p->res, cl_find_idx(p, name), n); }
+
+// handle getters: h is the index returned by cl_add_*
+
+static int cl_get_flag_at(Clargs *p, int h) { return cl_rget_flag(&p->res, h); }
+static const char *cl_get_string_at(Clargs *p, int h) { return cl_rget_string(&p->res, h); }
+
+static char cl_get_char_at(Clargs *p, int h, int *ok) { return cl_rget_char(&p->res, h, ok); }
+static short cl_get_short_at(Clargs *p, int h, int *ok) { return cl_rget_short(&p->res, h, ok); }
+static int cl_get_int_at(Clargs *p, int h, int *ok) { return cl_rget_int(&p->res, h, ok); }
+static long cl_get_long_at(Clargs *p, int h, int *ok) { return cl_rget_long(&p->res, h, ok); }
+static long long cl_get_llong_at(Clargs *p, int h, int *ok) { return cl_rget_llong(&p->res, h, ok); }
+
+static unsigned char cl_get_uchar_at(Clargs *p, int h, int *ok) { return cl_rget_uchar(&p->res, h, ok); }
+static unsigned short cl_get_ushort_at(Clargs *p, int h, int *ok) { return cl_rget_ushort(&p->res, h, ok); }
+static unsigned int cl_get_uint_at(Clargs *p, int h, int *ok) { return cl_rget_uint(&p->res, h, ok); }
+static unsigned long cl_get_ulong_at(Clargs *p, int h, int *ok) { return cl_rget_ulong(&p->res, h, ok); }
+static unsigned long long cl_get_ullong_at(Clargs *p, int h, int *ok) { return cl_rget_ullong(&p->res, h, ok); }
 
-static unsigned char cl_get_uchar(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0; } if (ok) *ok = 1; return a->val_uchar; }
-static unsigned short cl_get_ushort(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0; } if (ok) *ok = 1; return a->val_ushort; }
-static unsigned int cl_get_uint(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0u; } if (ok) *ok = 1; return a->val_uint; }
-static unsigned long cl_get_ulong(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0ul; } if (ok) *ok = 1; return a->val_ulong; }
-static unsigned long long cl_get_ullong(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0ull; } if (ok) *ok = 1; return a->val_ullong; }
+static size_t cl_get_size_at(Clargs *p, int h, int *ok) { return cl_rget_size(&p->res, h, ok); }
 
-static size_t cl_get_size(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return (size_t)0; } if (ok) *ok = 1; return a->val_size; }
+static float cl_get_float_at(Clargs *p, int h, int *ok) { return cl_rget_float(&p->res, h, ok); }
+static double cl_get_double_at(Clargs *p, int h, int *ok) { return cl_rget_double(&p->res, h, ok); }
 
-static float cl_get_float(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0.0f; } if (ok) *ok = 1; return a->val_float; }
-static double cl_get_double(Clargs *p, const char *name, int *ok) { Clarg *a = cl_find(p, name); if (!a) { if (ok) *ok = 0; return 0.0; } if (ok) *ok = 1; return a->val_double; }
+static const char *const *cl_get_strings_at(Clargs *p, int h, int *n) { return cl_rget_strings(&p->res, h, n); }
+static const char *cl_get_chars_at(Clargs *p, int h, int *n) { return cl_rget_chars(&p->res, h, n); }
+static const short *cl_get_shorts_at(Clargs *p, int h, int *n) { return cl_rget_shorts(&p->res, h, n); }
+static const int *cl_get_ints_at(Clargs *p, int h, int *n) { return cl_rget_ints(&p->res, h, n); }
+static const long *cl_get_longs_at(Clargs *p, int h, int *n) { return cl_rget_longs(&p->res, h, n); }
+static const long long *cl_get_llongs_at(Clargs *p, int h, int *n) { return cl_rget_llongs(&p->res, h, n); }
+static const unsigned char *cl_get_uchars_at(Clargs *p, int h, int *n) { return cl_rget_uchars(&p->res, h, n); }
+static const unsigned short *cl_get_ushorts_at(Clargs *p, int h, int *n) { return cl_rget_ushorts(&p->res, h, n); }
+static const unsigned int *cl_get_uints_at(Clargs *p, int h, int *n) { return cl_rget_uints(&p->res, h, n); }
+static const unsigned long *cl_get_ulongs_at(Clargs *p, int h, int *n) { return cl_rget_ulongs(&p->res, h, n); }
+static const unsigned long long *cl_get_ullongs_at(Clargs *p, int h, int *n) { return cl_rget_ullongs(&p->res, h, n); }
+static const size_t *cl_get_sizes_at(Clargs *p, int h, int *n) { return cl_rget_sizes(&p->res, h, n); }
+static const float *cl_get_floats_at(Clargs *p, int h, int *n) { return cl_rget_floats(&p->res, h, n); }
+static const double *cl_get_doubles_at(Clargs *p, int h, int *n) { return cl_rget_doubles(&p->res, h, n); }
 
 #endif
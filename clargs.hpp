@@ -0,0 +1,411 @@
+// C++17 companion to clargs.h: options are declared once in a table macro
+// that generates a struct with one typed member per option, a constexpr
+// option table, a perfect hash over the long names built by the compiler,
+// and one parse routine per option. Parsing allocates nothing, builds no
+// spec at run time, and values are read as plain members.
+/*
+    #define SERVER_OPTS(X) \
+        X('v', verbose, "verbose", ARG_FLAG,       0,         0, "Verbose output") \
+        X('p', port,    "port",    ARG_INT,        8080,      0, "Port to listen on") \
+        X('o', output,  "output",  ARG_STRING,     "out.txt", 0, "Output file") \
+        X(0,   input,   "input",   ARG_POSITIONAL, nullptr,   1, "Input file")
+    CLARGS_STRUCT(ServerArgs, "Example server", SERVER_OPTS);
+
+    ServerArgs a;
+    if (clargs::parse(a, argc, argv) != 0) return 1;
+    listen(a.port);
+*/
+
+#ifndef CLARGS_HPP
+#define CLARGS_HPP
+
+#include "clargs.h"
+#include <stdint.h>
+#include <type_traits>
+
+namespace clargs {
+
+// member type for each kind, matching what cl_bind_* writes
+template <int K> struct kind_type;
+template <> struct kind_type<ARG_FLAG> { typedef int type; };
+template <> struct kind_type<ARG_STRING> { typedef const char *type; };
+template <> struct kind_type<ARG_CHAR> { typedef char type; };
+template <> struct kind_type<ARG_SHORT> { typedef short type; };
+template <> struct kind_type<ARG_INT> { typedef int type; };
+template <> struct kind_type<ARG_LONG> { typedef long type; };
+template <> struct kind_type<ARG_LLONG> { typedef long long type; };
+template <> struct kind_type<ARG_UCHAR> { typedef unsigned char type; };
+template <> struct kind_type<ARG_USHORT> { typedef unsigned short type; };
+template <> struct kind_type<ARG_UINT> { typedef unsigned int type; };
+template <> struct kind_type<ARG_ULONG> { typedef unsigned long type; };
+template <> struct kind_type<ARG_ULLONG> { typedef unsigned long long type; };
+template <> struct kind_type<ARG_SIZE> { typedef size_t type; };
+template <> struct kind_type<ARG_FLOAT> { typedef float type; };
+template <> struct kind_type<ARG_DOUBLE> { typedef double type; };
+template <> struct kind_type<ARG_POSITIONAL> { typedef const char *type; };
+
+template <int K> using kind_t = typename kind_type<K>::type;
+
+// one row of the option table; the default is kept in whichever field
+// fits its kind so the help text can print it
+struct Option {
+    char short_name;
+    const char *long_name;
+    ArgKind kind;
+    bool required;
+    const char *help;
+    long long i;
+    unsigned long long u;
+    double d;
+    const char *s;
+};
+
+template <int K, class D>
+constexpr Option opt(char short_name, const char *long_name, D def, int req, const char *help) {
+    Option o = { short_name, long_name, (ArgKind)K, req != 0, help, 0, 0, 0, nullptr };
+    if constexpr (K == ARG_STRING || K == ARG_POSITIONAL) o.s = def;
+    else if constexpr (K == ARG_FLOAT || K == ARG_DOUBLE) o.d = (double)def;
+    else if constexpr (K == ARG_FLAG || K == ARG_CHAR || K == ARG_SHORT || K == ARG_INT || K == ARG_LONG || K == ARG_LLONG) o.i = (long long)def;
+    else o.u = (unsigned long long)def;
+    return o;
+}
+
+template <int K, class D>
+constexpr kind_t<K> def_value(D def) {
+    if constexpr (K == ARG_STRING || K == ARG_POSITIONAL) return def;
+    else return (kind_t<K>)def;
+}
+
+// parse status and error detail, as kept in a ClResult
+struct Error {
+    int err = CL_OK;
+    int tok = 0;
+    int off = 0;
+    int arg = -1;
+};
+
+// per-option parse routine: converts v into the member M of s
+template <class S, auto M, int K>
+bool store(S &s, const char *v) {
+    if constexpr (K == ARG_FLAG) { s.*M = 1; return true; }
+    else if constexpr (K == ARG_STRING || K == ARG_POSITIONAL) { s.*M = v; return true; }
+    else if constexpr (K == ARG_CHAR) { if (!v[0]) return false; s.*M = v[0]; return true; }
+    else if constexpr (K == ARG_FLOAT) return cl_convert_float(&(s.*M), 1, v) != 0;
+    else if constexpr (K == ARG_DOUBLE) return cl_convert_float(&(s.*M), 0, v) != 0;
+    else return cl_convert_int(&(s.*M), K, v) != 0;
+}
+
+// compile-time index
+
+constexpr uint32_t hash(const char *s, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i=0;i<n;i++) { h ^= (unsigned char)s[i]; h *= 16777619u; }
+    return h;
+}
+
+constexpr size_t length(const char *s) {
+    size_t n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+constexpr bool same(const char *a, const char *b) {
+    size_t i = 0;
+    for (; a[i] && a[i] == b[i]; i++) {}
+    return a[i] == b[i];
+}
+
+constexpr size_t pow2_at_least(size_t n) {
+    size_t p = 2;
+    while (p < n) p *= 2;
+    return p;
+}
+
+constexpr int log2_of(size_t p) {
+    int b = 0;
+    while (((size_t)1 << b) < p) b++;
+    return b;
+}
+
+// second-level position of a key hashed h in a bucket displaced by d
+constexpr uint32_t place(uint32_t h, uint32_t d, int bits) {
+    return (uint32_t)((h ^ (d * 0x9E3779B9u)) * 0x85EBCA6Bu) >> (32 - bits);
+}
+
+// hash-and-displace perfect hash: a key's bucket is picked by its low hash
+// bits, and every bucket carries the displacement that sends its keys to
+// free slots, so a lookup is one hash, two loads and one compare
+template <size_t N>
+struct Index {
+    static constexpr size_t B = pow2_at_least(N / 2 + 1);
+    static constexpr size_t M = pow2_at_least(2 * N);
+    static constexpr int bits = log2_of(M);
+    uint32_t disp[B] = {};
+    int16_t slot[M] = {};
+    int16_t shorts[256] = {};
+    int16_t pos[N ? N : 1] = {};
+    int npos = 0;
+};
+
+template <class S>
+constexpr Index<S::cl_count> build_index() {
+    constexpr size_t N = S::cl_count;
+    static_assert(N < 32768, "too many options for a 16-bit index");
+    typedef Index<N> I;
+    I ix;
+    uint32_t h[N ? N : 1] = {};
+    bool key[N ? N : 1] = {};
+    for (size_t i=0;i<I::M;i++) ix.slot[i] = -1;
+    for (int c=0;c<256;c++) ix.shorts[c] = -1;
+    for (size_t i=0;i<N;i++) {
+        const Option &o = S::cl_opts[i];
+        if (o.kind == ARG_POSITIONAL) ix.pos[ix.npos++] = (int16_t)i;
+        if (o.short_name && ix.shorts[(unsigned char)o.short_name] < 0) ix.shorts[(unsigned char)o.short_name] = (int16_t)i;
+        if (!o.long_name) continue;
+        // the first registration of a name wins, as in cl_index
+        h[i] = hash(o.long_name, length(o.long_name));
+        key[i] = true;
+        for (size_t j=0;j<i && key[i];j++)
+            if (key[j] && h[j] == h[i] && same(S::cl_opts[j].long_name, o.long_name)) key[i] = false;
+    }
+    // group the keys by bucket
+    size_t start[I::B + 1] = {};
+    int16_t member[N ? N : 1] = {};
+    for (size_t i=0;i<N;i++) if (key[i]) start[(h[i] & (I::B - 1)) + 1]++;
+    for (size_t b=0;b<I::B;b++) start[b+1] += start[b];
+    size_t at[I::B] = {};
+    for (size_t b=0;b<I::B;b++) at[b] = start[b];
+    for (size_t i=0;i<N;i++) if (key[i]) member[at[h[i] & (I::B - 1)]++] = (int16_t)i;
+    size_t most = 0;
+    for (size_t b=0;b<I::B;b++) if (start[b+1] - start[b] > most) most = start[b+1] - start[b];
+    // place the fullest buckets first while the table is emptiest
+    for (size_t size=most;size>0;size--) {
+        for (size_t b=0;b<I::B;b++) {
+            if (start[b+1] - start[b] != size) continue;
+            for (uint32_t d=0;;d++) {
+                if (d > (1u << 20)) throw "clargs: no perfect hash found";
+                size_t k = start[b];
+                for (;k<start[b+1];k++) {
+                    uint32_t s = place(h[member[k]], d, I::bits);
+                    if (ix.slot[s] >= 0) break;
+                    ix.slot[s] = member[k];
+                }
+                if (k == start[b+1]) { ix.disp[b] = d; break; }
+                while (k-- > start[b]) ix.slot[place(h[member[k]], d, I::bits)] = -1;
+            }
+        }
+    }
+    return ix;
+}
+
+template <class S>
+inline constexpr Index<S::cl_count> index_v = build_index<S>();
+
+// handle of a length-delimited name, with cl_lookup's rules: a single
+// character also matches short names and the earlier option wins
+template <class S>
+inline int lookup(const char *name, size_t len) {
+    typedef Index<S::cl_count> I;
+    const I &ix = index_v<S>;
+    int best = len == 1 ? ix.shorts[(unsigned char)name[0]] : -1;
+    uint32_t h = hash(name, len);
+    int k = ix.slot[place(h, ix.disp[h & (I::B - 1)], I::bits)];
+    if (k >= 0) {
+        const char *ln = S::cl_opts[k].long_name;
+        if (strncmp(ln, name, len) == 0 && ln[len] == '\0') return (best < 0 || k < best) ? k : best;
+    }
+    return best;
+}
+
+// position of an option in the table, for use in constant expressions:
+// a.cl_present[S::index("port")]
+template <class S>
+constexpr int index_of(const char *long_name) {
+    for (size_t i=0;i<S::cl_count;i++) if (S::cl_opts[i].long_name && same(S::cl_opts[i].long_name, long_name)) return (int)i;
+    return -1;
+}
+
+// parsing
+
+inline int fail(Error *e, int code, int tok, int off, int arg) {
+    if (e) { e->err = code; e->tok = tok; e->off = off; e->arg = arg; }
+    return code;
+}
+
+// same grammar and status codes as cl_parse_r; out is reset to its
+// defaults first. String members point into argv
+template <class S>
+int parse_r(S &out, int argc, char **argv, Error *e = nullptr) {
+    typedef bool (*Setter)(S &, const char *);
+    const Index<S::cl_count> &ix = index_v<S>;
+    const Option *opts = S::cl_opts;
+    const Setter *set = S::cl_setters();
+    int npos = 0;
+    out = S();
+    if (e) *e = Error();
+    for (int i=1;i<argc;i++) {
+        char *tok = argv[i];
+        if (!strcmp(tok, "--help") || !strcmp(tok, "-h")) return fail(e, CL_HELP, i, 0, -1);
+        if (tok[0] == '-' && tok[1] == '-') {
+            const char *name = tok + 2;
+            const char *eq = strchr(name, '=');
+            size_t n = eq ? (size_t)(eq - name) : strlen(name);
+            const char *val = eq ? eq + 1 : nullptr;
+            int idx = lookup<S>(name, n);
+            if (idx < 0) return fail(e, CL_ERR_UNKNOWN, i, 0, -1);
+            out.cl_present[idx] = 1;
+            if (opts[idx].kind == ARG_FLAG) { set[idx](out, ""); continue; }
+            int at = i;
+            if (!val) { if (i+1 >= argc) return fail(e, CL_ERR_MISSING_VALUE, i, 0, idx); val = argv[++i]; }
+            if (!set[idx](out, val)) return fail(e, CL_ERR_BAD_VALUE, at, 0, idx);
+        } else if (tok[0] == '-' && tok[1]) {
+            int len = (int)strlen(tok);
+            for (int k=1;k<len;k++) {
+                int idx = ix.shorts[(unsigned char)tok[k]];
+                if (idx < 0) return fail(e, CL_ERR_UNKNOWN, i, k, -1);
+                out.cl_present[idx] = 1;
+                if (opts[idx].kind == ARG_FLAG) { set[idx](out, ""); continue; }
+                const char *val = nullptr;
+                int at = i, off = k;
+                if (k+1 < len) { val = &tok[k+1]; k = len; }
+                else { if (i+1 >= argc) return fail(e, CL_ERR_MISSING_VALUE, i, k, idx); val = argv[++i]; }
+                if (!set[idx](out, val)) return fail(e, CL_ERR_BAD_VALUE, at, off, idx);
+            }
+        } else {
+            if (npos >= ix.npos) return fail(e, CL_ERR_UNEXPECTED, i, 0, -1);
+            int idx = ix.pos[npos++];
+            out.cl_present[idx] = 1;
+            set[idx](out, tok);
+        }
+    }
+    for (size_t i=0;i<S::cl_count;i++) {
+        const Option &o = opts[i];
+        if (!o.required || o.kind == ARG_FLAG || out.cl_present[i]) continue;
+        if (o.kind != ARG_STRING || !o.s) return fail(e, CL_ERR_REQUIRED, 0, 0, (int)i);
+    }
+    return CL_OK;
+}
+
+// help and error messages
+
+inline const char *default_meta(const Option &o) {
+    static const char *const metas[] = {
+        nullptr, "STR", "CHAR", "SHORT", "INT", "LONG", "LLONG", "UCHAR", "USHORT", "UINT", "ULONG", "ULLONG", "SIZE", "FLT", "DBL", nullptr
+    };
+    return o.kind == ARG_POSITIONAL ? o.long_name : metas[o.kind];
+}
+
+inline ClValue c_value(const Option &o) {
+    ClValue v;
+    memset(&v, 0, sizeof v);
+    switch (o.kind) {
+        case ARG_STRING: case ARG_POSITIONAL: v.str = o.s; break;
+        case ARG_CHAR: v.c = (char)o.i; break;
+        case ARG_SHORT: v.s = (short)o.i; break;
+        case ARG_FLAG: case ARG_INT: v.i = (int)o.i; break;
+        case ARG_LONG: v.l = (long)o.i; break;
+        case ARG_LLONG: v.ll = o.i; break;
+        case ARG_UCHAR: v.uc = (unsigned char)o.u; break;
+        case ARG_USHORT: v.us = (unsigned short)o.u; break;
+        case ARG_UINT: v.ui = (unsigned int)o.u; break;
+        case ARG_ULONG: v.ul = (unsigned long)o.u; break;
+        case ARG_ULLONG: v.ull = o.u; break;
+        case ARG_SIZE: v.sz = (size_t)o.u; break;
+        case ARG_FLOAT: v.f = (float)o.d; break;
+        case ARG_DOUBLE: v.d = o.d; break;
+    }
+    return v;
+}
+
+// the table laid out as the C spec's arrays, built once on first use, so
+// cl_help and cl_perror print exactly what the C parser would
+template <class S>
+struct CTable {
+    Clarg args[S::cl_count ? S::cl_count : 1];
+    ClargInfo info[S::cl_count ? S::cl_count : 1];
+    CTable() {
+        memset(args, 0, sizeof args);
+        for (size_t i=0;i<S::cl_count;i++) {
+            const Option &o = S::cl_opts[i];
+            args[i].long_name = o.long_name;
+            args[i].def = c_value(o);
+            args[i].kind = (unsigned char)o.kind;
+            args[i].short_name = o.short_name;
+            args[i].required = o.required;
+            info[i].meta = default_meta(o);
+            info[i].help = o.help;
+        }
+    }
+};
+
+template <class S>
+inline void c_spec(Clargs &p, const char *prog) {
+    static CTable<S> t;
+    memset(&p, 0, sizeof p);
+    p.prog = prog ? prog : "program";
+    p.desc = S::cl_desc;
+    p.args = t.args;
+    p.info = t.info;
+    p.cap = p.count = (int)S::cl_count;
+}
+
+template <class S>
+void help(const char *prog) {
+    Clargs p;
+    c_spec<S>(p, prog);
+    cl_help(&p);
+    free(p.help.s);     // the text cl_help rendered and cached on p
+}
+
+template <class S>
+void perror(const Error &e, char **argv) {
+    Clargs p;
+    ClResult r;
+    c_spec<S>(p, argv ? argv[0] : nullptr);
+    cl_index(&p);       // the name trie "Did you mean" is looked up in
+    memset(&r, 0, sizeof r);
+    r.err = e.err;
+    r.err_tok = e.tok;
+    r.err_off = e.off;
+    r.err_arg = e.arg;
+    cl_perror(&p, &r, argv);
+    free(p.slots);
+    free(p.pos);
+    free(p.required);
+    free(p.trie);
+}
+
+// cl_parse for a generated struct: prints help and exits on --help,
+// prints the error message and returns -1 on failure
+template <class S>
+int parse(S &out, int argc, char **argv) {
+    Error e;
+    int rc = parse_r(out, argc, argv, &e);
+    if (rc == CL_HELP) { help<S>(argc > 0 ? argv[0] : nullptr); exit(0); }
+    if (rc != CL_OK) { perror<S>(e, argv); return -1; }
+    return 0;
+}
+
+} // namespace clargs
+
+// table macro plumbing: each X(short, member, "long", KIND, default, req, help)
+#define CLARGS_X_MEMBER(sn, m, ln, k, def, req, help) ::clargs::kind_t<k> m = ::clargs::def_value<k>(def);
+#define CLARGS_X_COUNT(sn, m, ln, k, def, req, help) + 1
+#define CLARGS_X_OPT(sn, m, ln, k, def, req, help) ::clargs::opt<k>(sn, ln, def, req, help),
+#define CLARGS_X_SETTER(sn, m, ln, k, def, req, help) &::clargs::store<cl_self, &cl_self::m, k>,
+
+#define CLARGS_STRUCT(Name, desc, LIST) \
+    struct Name { \
+        typedef Name cl_self; \
+        LIST(CLARGS_X_MEMBER) \
+        static constexpr size_t cl_count = 0 LIST(CLARGS_X_COUNT); \
+        static constexpr const char *cl_desc = desc; \
+        static constexpr ::clargs::Option cl_opts[cl_count ? cl_count : 1] = { LIST(CLARGS_X_OPT) }; \
+        unsigned char cl_present[cl_count ? cl_count : 1] = {}; \
+        static const ::std::add_pointer_t<bool(Name &, const char *)> *cl_setters() { \
+            static constexpr ::std::add_pointer_t<bool(Name &, const char *)> t[cl_count ? cl_count : 1] = { LIST(CLARGS_X_SETTER) }; \
+            return t; \
+        } \
+    }
+
+#endif